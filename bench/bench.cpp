@@ -0,0 +1,243 @@
+// bench.cpp - Throughput benchmarks for the formatter library
+// Build and run with: make bench (make bench PROFILE=FILE for input
+// synthesized from a profile written by formatter --profile-input)
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "automaton.h"
+#include "highlight.h"
+#include "perf.h"
+#include "profile.h"
+#include "sink.h"
+#include "syntax_set.h"
+#include "tag_syntax.h"
+#include "width.h"
+
+namespace {
+
+constexpr size_t INPUT_SIZE = 16 * 1024 * 1024;
+constexpr int REPEATS       = 3;
+
+// Discards output, counting bytes so the work cannot be optimized away
+class NullSink : public Sink {
+public:
+    void write(std::string_view text) override { bytes += text.size(); }
+    void put(char) override { ++bytes; }
+    size_t bytes = 0;
+};
+
+// Best of REPEATS runs, with the hardware counters of that run
+class Measurement {
+public:
+    explicit Measurement(size_t bytes) : bytes_(bytes) {}
+
+    template <typename Work>
+    void run(Work&& work) {
+        counters().start();
+        auto begin = std::chrono::steady_clock::now();
+        work();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+        counters().stop();
+
+        double mbps = bytes_ / elapsed.count() / (1024 * 1024);
+        if (mbps > best_) {
+            best_   = mbps;
+            counts_ = counters().values();
+        }
+    }
+
+    // Name, throughput, a note, and the counters per input byte
+    void print(const char* name, const char* note) const {
+        std::printf("%-12s %9.1f MB/s  %s\n", name, best_, note);
+        if (!counters().available()) return;
+
+        using P = PerfCounters;
+        double bytes = static_cast<double>(bytes_);
+        std::printf("%-12s ", "");
+        if (counts_[P::CYCLES] && counts_[P::INSTRUCTIONS]) {
+            std::printf(" %5.2f IPC ", static_cast<double>(counts_[P::INSTRUCTIONS]) / counts_[P::CYCLES]);
+        }
+        for (int i = 0; i < P::NUM_EVENTS; ++i) {
+            if (!counters().has(static_cast<P::Event>(i))) continue;
+            std::printf(" %8.3f %s/B", static_cast<double>(counts_[i]) / bytes, P::NAMES[i]);
+        }
+        std::printf("\n");
+    }
+
+    static PerfCounters& counters() {
+        static PerfCounters counters;
+        return counters;
+    }
+
+private:
+    size_t bytes_;
+    double best_ = 0;
+    std::array<uint64_t, PerfCounters::NUM_EVENTS> counts_{};
+};
+
+// Log-like lines with a few tags, ids and timings
+std::string make_input() {
+    std::mt19937 rng(42);
+    std::string input;
+    input.reserve(INPUT_SIZE + 256);
+    char line[256];
+    while (input.size() < INPUT_SIZE) {
+        unsigned n = rng();
+        std::snprintf(line, sizeof line,
+                      "2024-05-%02u 12:%02u:%02u [svc%u] {%s--%s--} id%u-%u request took %ums user=u%u\n",
+                      n % 28 + 1, n % 60, (n >> 8) % 60, n % 120, (n & 1) ? "*g" : "r",
+                      (n & 2) ? "ok" : "failed", (n >> 4) % 120, n % 10000, (n >> 12) % 900, n % 5000);
+        input += line;
+    }
+    return input;
+}
+
+// The same lines as a generated fixture would spell them for -e: spaces
+// as \t, each line ending in \n
+std::string make_escaped(const std::string& input) {
+    std::string escaped;
+    escaped.reserve(input.size() * 5 / 4);
+    for (char c : input) {
+        if (c == ' ') {
+            escaped += "\\t";
+        } else if (c == '\n') {
+            escaped += "\\n\n";
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+// A generated template: every line indented, the indentation trimmed by
+// a \# at the end of the line before
+std::string make_indented(const std::string& input) {
+    std::string indented;
+    indented.reserve(input.size() * 3 / 2);
+    for (char c : input) {
+        indented += c;
+        if (c == '\n') indented += "\\#\n                                ";
+    }
+    return indented;
+}
+
+// `count` rules of a few typical shapes (literal, digits, classes, anchors)
+RegexHighlighter make_rules(int count) {
+    RegexHighlighter rules;
+    std::string error;
+    auto format = *SpecifierParser::parse("*y");
+    for (int i = 0; i < count; ++i) {
+        std::string pattern;
+        switch (i % 4) {
+        case 0: pattern = "\\[svc" + std::to_string(i) + "\\]"; break;
+        case 1: pattern = "id" + std::to_string(i) + "-\\d+";    break;
+        case 2: pattern = "took \\d{" + std::to_string(i % 3 + 1) + "}ms"; break;
+        case 3: pattern = "^2024-05-" + std::to_string(i % 28 + 10) + " [0-9:]+"; break;
+        }
+        if (!rules.add(pattern, format, error)) {
+            std::fprintf(stderr, "bad pattern %s: %s\n", pattern.c_str(), error.c_str());
+        }
+    }
+    return rules;
+}
+
+// `count` literal keywords: service names, user ids and words of the lines
+KeywordHighlighter make_keywords(int count) {
+    KeywordHighlighter keywords;
+    auto format = *SpecifierParser::parse("*c");
+    keywords.add("failed", format);
+    keywords.add("request", format);
+    for (int i = 2; i < count; ++i) {
+        keywords.add((i % 2 ? "[svc" : "user=u") + std::to_string(i / 2) + (i % 2 ? "]" : ""), format);
+    }
+    keywords.build();
+    return keywords;
+}
+
+void run(const char* name, const std::string& input, const std::function<void(FormatterAutomaton&)>& setup,
+         bool strip = false, const SyntaxSet& syntaxes = TagSyntax::CLASSIC, bool escape = false) {
+    Measurement m(input.size());
+    size_t out = 0;
+    for (int r = 0; r < REPEATS; ++r) {
+        NullSink sink;
+        m.run([&] {
+            FormatterAutomaton automaton(strip, escape, true, syntaxes, sink);
+            setup(automaton);
+            automaton.accept(input);
+        });
+        out = sink.bytes;
+    }
+    std::string note = "(" + std::to_string(out) + " bytes out)";
+    m.print(name, note.c_str());
+}
+
+// visible_width() per line, as a table renderer would call it per cell
+void run_width(const std::string& input) {
+    Measurement m(input.size());
+    size_t total = 0;
+    for (int r = 0; r < REPEATS; ++r) {
+        total = 0;
+        m.run([&] {
+            std::string_view rest(input);
+            while (!rest.empty()) {
+                size_t len = std::min(rest.find('\n'), rest.size());
+                total += visible_width(rest.substr(0, len));
+                rest.remove_prefix(std::min(len + 1, rest.size()));
+            }
+        });
+    }
+    std::string note = "(" + std::to_string(total) + " columns)";
+    m.print("width", note.c_str());
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    InputProfile profile;
+    if (argc > 1) {
+        FILE* file = std::fopen(argv[1], "r");
+        std::string error;
+        if (!file || !profile.load(file, error)) {
+            std::fprintf(stderr, "cannot load profile %s: %s\n", argv[1], file ? error.c_str() : "cannot open");
+            return 1;
+        }
+        std::fclose(file);
+    }
+    const std::string input = argc > 1 ? profile.generate(INPUT_SIZE) : make_input();
+    const bool escape       = profile.escapes() > 0; // the profiled input was read with -e
+    std::printf("input: %zu bytes%s, best of %d\n", input.size(), argc > 1 ? " from profile" : "", REPEATS);
+    const PerfCounters& counters = Measurement::counters();
+    if (counters.available()) {
+        std::printf("hardware counters per input byte, user space only\n\n");
+    } else {
+        std::printf("hardware counters unavailable: %s\n\n", counters.error().c_str());
+    }
+
+    run("render", input, [](FormatterAutomaton&) {}, false, TagSyntax::CLASSIC, escape);
+    run("strip", input, [](FormatterAutomaton&) {}, true, TagSyntax::CLASSIC, escape);
+    run_width(input);
+
+    SyntaxSet all;
+    for (const TagSyntax* syntax : TagSyntax::ALL_STYLES) all.add(*syntax);
+    run("syntaxes-3", input, [](FormatterAutomaton&) {}, false, all);
+    run("escapes", make_escaped(input), [](FormatterAutomaton&) {}, false, TagSyntax::CLASSIC, true);
+    run("trim", make_indented(input), [](FormatterAutomaton&) {}, false, TagSyntax::CLASSIC, true);
+
+    for (int count : {10, 1000}) {
+        KeywordHighlighter keywords = make_keywords(count);
+        std::string name            = "keywords-" + std::to_string(count);
+        run(name.c_str(), input, [&](FormatterAutomaton& a) { a.add_highlighter(keywords); });
+    }
+    for (int count : {1, 10, 100}) {
+        RegexHighlighter rules = make_rules(count);
+        std::string name       = "rules-" + std::to_string(count);
+        run(name.c_str(), input, [&](FormatterAutomaton& a) { a.add_highlighter(rules); });
+    }
+    return 0;
+}
@@ -0,0 +1,174 @@
+// latency.cpp - Per-line latency of the formatter behind a pseudo-terminal
+// Build and run with: make latency
+//
+// Runs the formatter binary with its stdout on a PTY, as in an interactive
+// session, writes one tagged line at a time and measures how long it takes
+// until the rendered line can be read back. Every flush policy is run with
+// input from a pipe and from the terminal itself.
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <poll.h>
+#include <pty.h>
+#include <string>
+#include <sys/wait.h>
+#include <termios.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+constexpr int LINES      = 2000;
+constexpr int TIMEOUT_MS = 200; // a line not rendered by then is held back
+
+using Clock = std::chrono::steady_clock;
+
+struct Child {
+    pid_t pid  = -1;
+    int master = -1; // PTY: the formatter's stdout (and stdin in tty mode)
+    int input  = -1; // where to write input
+};
+
+Child spawn(const char* formatter, const char* policy, bool tty_input) {
+    int pipe_fds[2] = {-1, -1};
+    if (!tty_input && pipe(pipe_fds) != 0) {
+        std::perror("pipe");
+        std::exit(EXIT_FAILURE);
+    }
+
+    // Raw mode from the start: no echo, no '\n' -> "\r\n" translation
+    termios raw{};
+    cfmakeraw(&raw);
+    cfsetspeed(&raw, B38400);
+
+    Child child;
+    std::string flush = std::string("--flush=") + policy;
+    child.pid = forkpty(&child.master, nullptr, &raw, nullptr);
+    if (child.pid < 0) {
+        std::perror("forkpty");
+        std::exit(EXIT_FAILURE);
+    }
+    if (child.pid == 0) {
+        if (!tty_input) {
+            dup2(pipe_fds[0], STDIN_FILENO);
+            close(pipe_fds[0]);
+            close(pipe_fds[1]);
+        }
+        execl(formatter, formatter, flush.c_str(), static_cast<char*>(nullptr));
+        std::perror(formatter);
+        _exit(127);
+    }
+
+    if (tty_input) {
+        child.input = child.master;
+    } else {
+        close(pipe_fds[0]);
+        child.input = pipe_fds[1];
+    }
+    return child;
+}
+
+void stop(Child& child) {
+    if (child.input != child.master) close(child.input);
+    kill(child.pid, SIGTERM);
+    waitpid(child.pid, nullptr, 0);
+    close(child.master);
+}
+
+// Read until `newlines` more line ends arrived; false on timeout
+bool await_lines(int fd, int newlines, std::string& scratch) {
+    auto deadline = Clock::now() + std::chrono::milliseconds(TIMEOUT_MS);
+    char buf[4096];
+    while (newlines > 0) {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count();
+        pollfd pfd{fd, POLLIN, 0};
+        if (left <= 0 || poll(&pfd, 1, static_cast<int>(left)) <= 0) return false;
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (n <= 0) return false;
+        newlines -= static_cast<int>(std::count(buf, buf + n, '\n'));
+        scratch.assign(buf, static_cast<size_t>(n));
+    }
+    return true;
+}
+
+void write_all(int fd, const std::string& data) {
+    for (size_t done = 0; done < data.size();) {
+        ssize_t n = write(fd, data.data() + done, data.size() - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            std::perror("write");
+            std::exit(EXIT_FAILURE);
+        }
+        done += static_cast<size_t>(n);
+    }
+}
+
+double percentile(const std::vector<double>& sorted, double p) {
+    size_t i = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[std::min(i, sorted.size() - 1)];
+}
+
+void run(const char* formatter, const char* policy, bool tty_input) {
+    Child child = spawn(formatter, policy, tty_input);
+    std::string scratch;
+    std::vector<double> micros;
+    micros.reserve(LINES);
+
+    bool held = false;
+    for (int i = 0; i < LINES && !held; ++i) {
+        std::string line = "{r--line " + std::to_string(i) + "--} {*g--ok--}\n";
+        auto begin       = Clock::now();
+        write_all(child.input, line);
+        held = !await_lines(child.master, 1, scratch);
+        std::chrono::duration<double, std::micro> elapsed = Clock::now() - begin;
+        if (!held) micros.push_back(elapsed.count());
+    }
+    stop(child);
+
+    std::printf("%-5s %-5s ", policy, tty_input ? "tty" : "pipe");
+    if (held) {
+        std::printf("held: line %zu not rendered within %d ms\n", micros.size() + 1, TIMEOUT_MS);
+        return;
+    }
+
+    std::sort(micros.begin(), micros.end());
+    std::printf("%8.1f %8.1f %8.1f %8.1f   ", percentile(micros, 0.5), percentile(micros, 0.9),
+                percentile(micros, 0.99), micros.back());
+
+    // Power-of-two buckets from 8 us
+    int buckets[8] = {};
+    for (double us : micros) {
+        int b = 0;
+        for (double limit = 8; us >= limit && b < 7; limit *= 2) ++b;
+        ++buckets[b];
+    }
+    for (int count : buckets) std::printf("%5d", count);
+    std::printf("\n");
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const char* formatter = argc > 1 ? argv[1] : "./formatter";
+    if (access(formatter, X_OK) != 0) {
+        std::fprintf(stderr, "formatter binary not found: %s\n", formatter);
+        return EXIT_FAILURE;
+    }
+
+    std::printf("%d lines per run, latency in microseconds (write -> rendered line readable)\n\n", LINES);
+    std::printf("%-5s %-5s %8s %8s %8s %8s   ", "flush", "input", "p50", "p90", "p99", "max");
+    for (const char* bucket : {"<8", "<16", "<32", "<64", "<128", "<256", "<512", "more"}) {
+        std::printf("%5s", bucket);
+    }
+    std::printf("\n");
+    for (const char* policy : {"auto", "line", "none", "full", "sync"}) {
+        for (bool tty_input : {false, true}) {
+            run(formatter, policy, tty_input);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,132 @@
+// alphabet.h - The characters of format specifiers, remappable
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <iterator>
+#include <string>
+#include <string_view>
+
+#include "config_file.h"
+#include "syntax.h"
+
+// Which character stands for which color, style or reset in a specifier,
+// compiled into one byte -> action table: parsing a specifier character is
+// a single lookup whatever the alphabet. The standard alphabet is the one
+// in syntax.h ("krgybmcw", "*/_" ...); load() moves single entries to other
+// characters, e.g. when tagged payloads themselves contain '*' or '_'.
+class SpecifierAlphabet {
+public:
+    struct Action {
+        enum Kind : uint8_t { NONE, COLOR, STYLE, RESET };
+        Kind kind     = NONE;
+        uint8_t value = 0; // COLOR: Color | 16 if bright; STYLE: style bit index
+    };
+
+    // Entries in the order of NAMES: 8 colors, 8 bright ones, default,
+    // current, the styles by style bit and reset
+    static constexpr size_t NUM_ENTRIES = 28;
+    static constexpr std::string_view NAMES[NUM_ENTRIES] = {
+        "black", "red", "green", "yellow", "blue", "magenta", "cyan", "white",
+        "bright-black", "bright-red", "bright-green", "bright-yellow",
+        "bright-blue", "bright-magenta", "bright-cyan", "bright-white",
+        "default", "current",
+        "reversed", "blink", "bold", "italic", "underline", "overline",
+        "double-underline", "strikethrough", "dim",
+        "reset",
+    };
+
+    SpecifierAlphabet();
+
+    static const SpecifierAlphabet& standard() {
+        static const SpecifierAlphabet alphabet;
+        return alphabet;
+    }
+
+    const Action& operator[](uint8_t c) const { return table_[c]; }
+
+    // Read "NAME CHAR" lines (e.g. "bold +", "bright-red !"), each moving one
+    // entry to another character; the entries not listed keep theirs. Blank
+    // lines and lines starting with '#' are skipped. Returns false and fills
+    // `error` on an invalid line or when two entries end up on one character.
+    bool load(FILE* file, std::string& error);
+
+private:
+    std::array<char, NUM_ENTRIES> chars_;
+    std::array<Action, 256> table_{};
+
+    static Action action_of(size_t entry);
+
+    // Build table_ from chars_; false and `error` on a clash
+    bool compile(std::string& error);
+};
+
+// Implementation
+
+inline SpecifierAlphabet::SpecifierAlphabet() {
+    using namespace syntax::style;
+    for (size_t i = 0; i < COLOR_CHARS_LOWER.size(); ++i) {
+        chars_[i]     = COLOR_CHARS_LOWER[i];
+        chars_[i + 8] = COLOR_CHARS_UPPER[i];
+    }
+    constexpr char REST[] = {
+        syntax::COLOR_DEFAULT, syntax::COLOR_CURRENT,
+        REVERSED, BLINK, BOLD, ITALIC, UNDERLINE, OVERLINE, DOUBLE_UNDERLINE, STRIKETHROUGH, DIM,
+        syntax::RESET_CHAR,
+    };
+    for (size_t i = 0; i < std::size(REST); ++i) chars_[16 + i] = REST[i];
+
+    std::string error;
+    compile(error);
+}
+
+inline SpecifierAlphabet::Action SpecifierAlphabet::action_of(size_t entry) {
+    if (entry < 16) return {Action::COLOR, static_cast<uint8_t>((entry & 7) | (entry & 8 ? 16 : 0))};
+    if (entry == 16) return {Action::COLOR, DEFAULT};
+    if (entry == 17) return {Action::COLOR, CURRENT};
+    if (entry < NUM_ENTRIES - 1) return {Action::STYLE, static_cast<uint8_t>(entry - 18)};
+    return {Action::RESET, 0};
+}
+
+inline bool SpecifierAlphabet::compile(std::string& error) {
+    std::array<int, 256> owner;
+    owner.fill(-1);
+    table_ = {};
+    for (size_t i = 0; i < NUM_ENTRIES; ++i) {
+        auto c = static_cast<uint8_t>(chars_[i]);
+        if (owner[c] >= 0) {
+            error = "'" + std::string(1, chars_[i]) + "' used for both " + std::string(NAMES[owner[c]]) +
+                    " and " + std::string(NAMES[i]);
+            return false;
+        }
+        owner[c]  = static_cast<int>(i);
+        table_[c] = action_of(i);
+    }
+    return true;
+}
+
+inline bool SpecifierAlphabet::load(FILE* file, std::string& error) {
+    bool ok = read_config_lines(file, error, [this](std::string_view line, std::string& why) {
+        std::string_view entry = line.substr(line.find_first_not_of(" \t"));
+        entry                  = entry.substr(0, entry.find_last_not_of(" \t") + 1);
+
+        size_t space = entry.find_first_of(" \t");
+        size_t value = space == std::string_view::npos ? space : entry.find_first_not_of(" \t", space);
+        if (value == std::string_view::npos || value + 1 != entry.size()) {
+            why = "expected 'NAME CHAR', got '" + std::string(line) + "'";
+            return false;
+        }
+
+        std::string_view name = entry.substr(0, space);
+        size_t i = 0;
+        while (i < NUM_ENTRIES && NAMES[i] != name) ++i;
+        if (i == NUM_ENTRIES) {
+            why = "unknown name '" + std::string(name) + "'";
+            return false;
+        }
+        chars_[i] = entry[value];
+        return true;
+    });
+    return ok && compile(error);
+}
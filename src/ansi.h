@@ -30,7 +30,27 @@ constexpr std::string_view ESC_START = "\e[";
 constexpr char             ESC_END   = 'm';
 constexpr char             SEP       = ';';
 
+// Erase from the cursor to the end of the line
+constexpr std::string_view ERASE_LINE = "\e[K";
+
 // Max ANSI sequence length: "\e[" + ~12 codes×3 chars + "m" ≈ 48 bytes
 constexpr size_t MAX_SEQ_LEN = 48;
 
+// Length of the CSI sequence ("\e[", parameters, final byte) at the start of
+// `text`, or 0 if `text` does not start with a complete one
+inline size_t csi_length(std::string_view text) {
+    if (text.size() < 2 || text[0] != '\e' || text[1] != '[') return 0;
+    for (size_t i = 2; i < text.size(); ++i) {
+        if (text[i] >= 0x40 && text[i] <= 0x7e) return i + 1;
+    }
+    return 0;
+}
+
+// Whether a CSI sequence is an SGR that starts from the default state
+// ("\e[m" or a leading 0 parameter), making earlier SGRs irrelevant
+inline bool sgr_resets(std::string_view seq) {
+    if (seq.size() < 3 || seq.back() != ESC_END) return false;
+    return seq[2] == ESC_END || (seq[2] == '0' && (seq[3] == SEP || seq[3] == ESC_END));
+}
+
 } // namespace ansi
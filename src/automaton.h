@@ -1,79 +1,236 @@
 // automaton.h - Formatter state machine for parsing and transforming tagged text
 #pragma once
 
-#include <cctype>
-#include <cstdio>
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+#include <memory>
 #include <stack>
 #include <string>
+#include <vector>
 
+#include "escape.h"
 #include "format.h"
+#include "highlight.h"
+#include "palette.h"
+#include "sink.h"
+#include "specifier.h"
 #include "syntax.h"
+#include "syntax_set.h"
 #include "tag_syntax.h"
 
+// Told about the markup an automaton parses, e.g. to profile an input
+class MarkupObserver {
+public:
+    virtual ~MarkupObserver() = default;
+    // A tag was opened with `specifier`, `depth` tags deep (1 = outermost)
+    virtual void tag(std::string_view specifier, size_t depth) = 0;
+    // An escape (-e) was recognised; `kind` is the character after the backslash
+    virtual void escape(char kind) = 0;
+};
+
 // State machine that processes input character-by-character,
 // transforming format tags into ANSI escape sequences
 class FormatterAutomaton {
 public:
-    FormatterAutomaton(bool strip, bool escape, bool sanitize, const TagSyntax& syntax = TagSyntax::CLASSIC)
-        : strip_(strip), escape_(escape), sanitize_(sanitize), syntax_(syntax) {
+    // Several syntaxes may be given as a SyntaxSet; tags of any of them are
+    // recognised, and a tag is closed by the close tag of any of them.
+    // `palette` and `alphabet` must outlive the automaton.
+    FormatterAutomaton(bool strip, bool escape, bool sanitize, const SyntaxSet& syntaxes = TagSyntax::CLASSIC,
+                       Sink& sink = StdioSink::standard_output(), const Palette& palette = Palette::standard(),
+                       const SpecifierAlphabet& alphabet = SpecifierAlphabet::standard())
+        : strip_(strip), escape_(escape), sanitize_(sanitize), syntaxes_(syntaxes), sink_(sink),
+          palette_(palette), specifier_(alphabet) {
+        for (size_t c = 0; c < plain_.size(); ++c) {
+            auto byte = static_cast<uint8_t>(c);
+            plain_[c] = syntaxes_.plain(byte) && !(escape_ && byte == syntax::ESCAPE_CHAR);
+            opens_[c] = syntaxes_.open_starting_with(byte) || (escape_ && byte == syntax::ESCAPE_CHAR);
+        }
         format_stack_.push(Format::initial());
-        emit_ansi(format_stack_.top().to_ansi());
+        emit_ansi(ansi(format_stack_.top()));
+    }
+
+    ~FormatterAutomaton() { finish(); }
+
+    // Process a single input character
+    void accept(int c);
+
+    // Process a chunk of input; same result as accepting it byte by byte, but
+    // text between tags (with single-character escapes decoded) goes out in
+    // spans
+    void accept(std::string_view input);
+
+    // When no tag or escape is being parsed, drop the plain text at the start
+    // of `input` instead of accepting it (e.g. text that would be cut off).
+    // Returns its length; the caller goes on after it.
+    size_t skip_text(std::string_view input) const;
+
+    // Process `text` as visible text: tags and escapes in it are not
+    // recognised. A tag or escape still being parsed ends before it.
+    void accept_text(std::string_view text);
+
+    // Highlight matches in visible text as if they were tagged. Highlighters
+    // are consulted in order; the first one to claim a span wins.
+    // The highlighter must outlive the automaton; it may be shared with others.
+    void add_highlighter(const Highlighter& highlighter) {
+        flush_segment(); // it has not scanned the held text
+        highlighters_.push_back(&highlighter);
+        scratch_.push_back(highlighter.make_scratch());
+    }
+
+    // Report tags and escapes to `observer` (nullptr: to no one). Input is
+    // then accepted byte by byte.
+    void set_observer(MarkupObserver* observer) { observer_ = observer; }
+
+    // Start over on new input, keeping the configuration and allocated
+    // buffers. Pending input of the previous run is discarded.
+    void reset() {
+        state_    = State::DEFAULT;
+        finished_ = false;
+        clear_buffer();
+        segment_.clear();
+        line_start_ = true;
+        specifier_.reset();
+        while (format_stack_.size() > 1) format_stack_.pop();
+        format_stack_.top() = Format::initial();
+        emit_ansi(ansi(format_stack_.top()));
     }
 
-    ~FormatterAutomaton() {
+    const TagSyntax& syntax() const { return syntaxes_[0]; } // the first one of the set
+    uint64_t tags() const { return tags_; }                   // open tags parsed so far
+    bool escape() const { return escape_; }
+
+    // Flush pending input and emit the final reset; further input is ignored
+    void finish() {
+        if (finished_) return;
+        if (state_ == State::PARSE_ESCAPE_NUMBER && !number_.empty()) {
+            finish_number(); // e.g. "\x41" at the very end
+        }
         flush_buffer();
+        flush_segment(true);
         if (sanitize_) {
-            emit_ansi(Format::initial().to_ansi());
+            // The terminal's own defaults, not the palette's: whatever comes
+            // after the output starts from a clean state
+            emit_ansi(ansi(Format::initial(), Palette::standard()));
         }
+        finished_ = true;
     }
 
-    // Process a single input character
-    void accept(int c);
-
 private:
     // Configuration
     const bool strip_;            // strip formatting instead of emitting ANSI
     const bool escape_;           // enable escape sequences
     const bool sanitize_;         // emit reset on destruction
-    const TagSyntax& syntax_;     // tag syntax configuration
+    const SyntaxSet syntaxes_;    // tag syntax configuration
+    Sink& sink_;                  // output destination
+    const Palette& palette_;      // SGR codes of colors
 
     // Parser states
     enum class State {
         DEFAULT,
         PARSE_ESCAPE,
+        PARSE_ESCAPE_NUMBER,   // digits of \xHH, \uXXXX or \NNN
         PARSE_OPENING_TAG,     // matching multi-char open_tag
         PARSE_OPENING_BRACKET, // parsing format specifier
         PARSE_CLOSING_TAG,     // matching close tag like [/] or </>
         SKIP_WHITESPACE,       // consuming whitespace after \#
     };
 
-    State state_ = State::DEFAULT;
+    State state_   = State::DEFAULT;
+    bool finished_ = false;
+    uint64_t tags_ = 0;
     std::string buffer_;
-    std::stack<Format> format_stack_;
+    std::stack<Format, std::vector<Format>> format_stack_;
+
+    // Tag matching: close tag DFA state over buffer_ (DEFAULT state), open
+    // tags buffer_ may still become, and the syntax of the tag being parsed
+    int32_t close_state_      = SyntaxSet::ROOT;
+    uint32_t open_candidates_ = 0;
+    size_t active_            = 0;
+
+    // Highlighting: visible text is held per segment (up to a tag or newline)
+    std::vector<const Highlighter*> highlighters_;
+    std::vector<std::unique_ptr<Highlighter::Scratch>> scratch_; // one per highlighter
+    std::string segment_;
+    bool line_start_ = true; // segment_ begins a line of visible text
+    MarkupObserver* observer_ = nullptr;
+    std::vector<Match> matches_;
+    static constexpr size_t MAX_SEGMENT = 64 * 1024;
     
     // Current bracket parsing state
-    Format bracket_format_  = Format::empty();
-    int parsed_colors_      = 0;
-    uint16_t parsed_styles_ = 0;
+    SpecifierParser specifier_;
+
+    // Escapes: the numeric one being parsed, bytes that never start or end a
+    // tag or an escape (accepted in spans by the bulk accept()), and bytes
+    // that start an open tag or an escape (which end a span)
+    escape::Number number_;
+    std::array<bool, 256> plain_{};
+    std::array<bool, 256> opens_{};
+    std::string decoded_;
 
     // Output helpers
-    void emit_ansi(const std::string& ansi) const {
+    // SGR sequence of `format`; none in strip mode, which does not write it
+    std::string ansi(const Format& format, const Palette& palette) const {
+        return strip_ ? std::string() : format.to_ansi(palette);
+    }
+    std::string ansi(const Format& format) const { return ansi(format, palette_); }
+
+    void emit_ansi(const std::string& ansi) {
+        flush_segment();
+        write_ansi(ansi);
+    }
+
+    void write_ansi(const std::string& ansi) const {
         if (!strip_) {
-            std::fputs(ansi.c_str(), stdout);
+            sink_.write(ansi);
+        }
+    }
+
+    void emit_char(int c) {
+        char ch = static_cast<char>(c);
+        if (highlighters_.empty()) {
+            sink_.put(ch);
+        } else {
+            emit_text(std::string_view(&ch, 1));
         }
     }
 
-    static void emit_char(int c) {
-        std::putchar(c);
+    // Visible text goes through here so highlighters can see it, scanning
+    // it as it is held
+    void emit_text(std::string_view text) {
+        if (highlighters_.empty()) {
+            sink_.write(text);
+            return;
+        }
+        while (!text.empty()) {
+            // Up to the end of the line or of the segment's room
+            size_t len = std::min(text.size(), MAX_SEGMENT - segment_.size());
+            if (const void* nl = std::memchr(text.data(), '\n', len)) {
+                len = static_cast<size_t>(static_cast<const char*>(nl) - text.data()) + 1;
+            }
+            std::string_view part = text.substr(0, len);
+            segment_ += part;
+            for (size_t h = 0; h < highlighters_.size(); ++h) highlighters_[h]->scan(part, scratch_[h].get());
+            if (part.back() == '\n' || segment_.size() >= MAX_SEGMENT) flush_segment();
+            text.remove_prefix(len);
+        }
     }
 
+    void flush_segment(bool end_of_input = false);
+
     // Buffer management
     void buffer_char(int c) { buffer_ += static_cast<char>(c); }
-    void clear_buffer() { buffer_.clear(); }
+
+    void clear_buffer() {
+        buffer_.clear();
+        close_state_ = SyntaxSet::ROOT;
+    }
     
     void flush_buffer() {
+        close_state_ = SyntaxSet::ROOT;
         if (!buffer_.empty()) {
-            std::fputs(buffer_.c_str(), stdout);
+            emit_text(buffer_);
             buffer_.clear();
         }
     }
@@ -91,8 +248,9 @@ private:
 
     // Check if buffer suffix could be a prefix of the given pattern
     bool could_match_prefix(std::string_view pattern) const {
-        for (size_t i = 1; i <= pattern.size() && i <= buffer_.size(); ++i) {
-            if (buffer_.substr(buffer_.size() - i) == pattern.substr(0, i)) {
+        std::string_view buffer(buffer_);
+        for (size_t i = 1; i <= pattern.size() && i <= buffer.size(); ++i) {
+            if (buffer.substr(buffer.size() - i) == pattern.substr(0, i)) {
                 return true;
             }
         }
@@ -101,6 +259,7 @@ private:
 
     // Format stack operations
     std::string push_format(const Format& mask) {
+        flush_segment(); // held text belongs to the previous format
         Format format = format_stack_.top();
 
         if (mask.reset) {
@@ -121,14 +280,15 @@ private:
         }
 
         format_stack_.push(format);
-        return format.to_ansi();
+        return ansi(format);
     }
 
     std::string pop_format() {
+        flush_segment();
         if (format_stack_.size() > 1) {
             format_stack_.pop();
         }
-        return format_stack_.top().to_ansi();
+        return ansi(format_stack_.top());
     }
 
     // Bracket parsing helpers
@@ -138,101 +298,92 @@ private:
         } else {
             flush_buffer();
         }
-        parsed_colors_  = 0;
-        parsed_styles_  = 0;
-        bracket_format_ = Format::empty();
-        state_          = State::DEFAULT;
+        specifier_.reset();
+        state_ = State::DEFAULT;
     }
 
-    bool try_parse_color(int c);
-    bool try_parse_style(int c);
-
     // State handlers
     void handle_escape(int c);
-    void handle_skip_whitespace(int c);
+    void handle_escape_number(int c);
+    void finish_number();
     void handle_closing_tag(int c);
     void handle_opening_tag(int c);
+    void match_opening_tag();
     void handle_opening_bracket(int c);
     void handle_default(int c);
 };
 
 // Implementation
 
-inline bool FormatterAutomaton::try_parse_color(int c) {
-    Color color;
-    bool bright = false;
-
-    auto pos = COLOR_CHARS_LOWER.find(static_cast<char>(c));
-    if (pos != std::string_view::npos) {
-        color = static_cast<Color>(pos);
-    } else if ((pos = COLOR_CHARS_UPPER.find(static_cast<char>(c))) != std::string_view::npos) {
-        color  = static_cast<Color>(pos);
-        bright = true;
-    } else if (c == syntax::COLOR_DEFAULT) {
-        color = DEFAULT;
-    } else if (c == syntax::COLOR_CURRENT) {
-        color = CURRENT;
-    } else {
-        return false;
-    }
-
-    if (parsed_colors_ >= 2) return false;
-
-    if (parsed_colors_ == 0) {
-        bracket_format_.set_fg(color, bright);
-    } else {
-        bracket_format_.set_bg(color, bright);
+inline void FormatterAutomaton::flush_segment(bool end_of_input) {
+    if (segment_.empty()) return;
+
+    // Detach the text first: push_format()/pop_format() below flush again
+    std::string segment;
+    segment.swap(segment_);
+    bool line_start = line_start_;
+    bool line_end   = end_of_input || segment.back() == '\n';
+    line_start_     = segment.back() == '\n';
+
+    matches_.clear();
+    size_t claimed = 0; // matches_[0, claimed) are accepted, sorted and disjoint
+    for (size_t h = 0; h < highlighters_.size(); ++h) {
+        size_t first = matches_.size();
+        highlighters_[h]->find(segment, line_start, line_end, scratch_[h].get(), matches_);
+        // Keep new matches that do not overlap earlier highlighters' ones
+        for (size_t i = first; i < matches_.size(); ++i) {
+            bool overlaps = false;
+            for (size_t j = 0; j < claimed && !overlaps; ++j) {
+                overlaps = matches_[i].begin < matches_[j].end && matches_[j].begin < matches_[i].end;
+            }
+            if (!overlaps) matches_[claimed++] = matches_[i];
+        }
+        matches_.resize(claimed);
     }
-    parsed_colors_++;
-    return true;
-}
-
-inline bool FormatterAutomaton::try_parse_style(int c) {
-    using namespace syntax::style;
-    uint16_t style_bit = 0;
-
-    switch (c) {
-    case REVERSED:         style_bit = REVERSED_BIT;         break;
-    case BLINK:            style_bit = BLINK_BIT;            break;
-    case BOLD:             style_bit = BOLD_BIT;             break;
-    case ITALIC:           style_bit = ITALIC_BIT;           break;
-    case UNDERLINE:        style_bit = UNDERLINE_BIT;        break;
-    case OVERLINE:         style_bit = OVERLINE_BIT;         break;
-    case DOUBLE_UNDERLINE: style_bit = DOUBLE_UNDERLINE_BIT; break;
-    case STRIKETHROUGH:    style_bit = STRIKETHROUGH_BIT;    break;
-    case DIM:              style_bit = DIM_BIT;              break;
-    case syntax::RESET_CHAR:
-        bracket_format_.reset = 1;
-        return true;
-    default:
-        return false;
+    std::sort(matches_.begin(), matches_.end(),
+              [](const Match& a, const Match& b) { return a.begin < b.begin; });
+
+    std::string_view text(segment);
+    size_t pos = 0;
+    for (const Match& m : matches_) {
+        sink_.write(text.substr(pos, m.begin - pos));
+        write_ansi(push_format(m.format));
+        sink_.write(text.substr(m.begin, m.end - m.begin));
+        write_ansi(pop_format());
+        pos = m.end;
     }
+    sink_.write(text.substr(pos));
 
-    // Duplicate style in same bracket is invalid
-    if (parsed_styles_ & style_bit) return false;
-
-    parsed_styles_ |= style_bit;
-    bracket_format_.set_style_bits(bracket_format_.style_bits() | style_bit);
-    return true;
+    segment.clear();
+    segment_.swap(segment); // keep the capacity
 }
 
 inline void FormatterAutomaton::handle_escape(int c) {
-    clear_buffer();
-    switch (c) {
-    case syntax::ESCAPE_CHAR: emit_char(syntax::ESCAPE_CHAR); break;
-    case 'a': emit_char('\a'); break;
-    case 'b': emit_char('\b'); break;
-    case 'r': emit_char('\r'); break;
-    case 'n': emit_char('\n'); break;
-    case 'f': emit_char('\f'); break;
-    case 't': emit_char('\t'); break;
-    case 'v': emit_char('\v'); break;
-    case syntax::TRIM_ESCAPE:
+    const escape::Entry& entry = escape::TABLE[static_cast<uint8_t>(c)];
+    if (observer_ && entry.kind != escape::Kind::INVALID) observer_->escape(static_cast<char>(c));
+    switch (entry.kind) {
+    case escape::Kind::CHAR:
+        clear_buffer();
+        emit_char(entry.value);
+        break;
+    case escape::Kind::TRIM:
+        clear_buffer();
         state_ = State::SKIP_WHITESPACE;
         return;
-    default:
+    case escape::Kind::HEX:
+    case escape::Kind::UNICODE:
+    case escape::Kind::OCTAL:
+        // Keep the text in the buffer in case no digits follow
+        buffer_char(c);
+        number_.start(entry.kind);
+        state_ = State::PARSE_ESCAPE_NUMBER;
+        if (entry.kind == escape::Kind::OCTAL) {
+            number_.accept(c);
+            if (number_.full()) finish_number();
+        }
+        return;
+    case escape::Kind::INVALID:
         // Invalid escape - output backslash and current char
-        emit_char(syntax::ESCAPE_CHAR);
         buffer_char(c);
         flush_buffer();
         break;
@@ -240,18 +391,36 @@ inline void FormatterAutomaton::handle_escape(int c) {
     state_ = State::DEFAULT;
 }
 
-inline void FormatterAutomaton::handle_skip_whitespace(int c) {
-    if (std::isspace(c)) return; // consume whitespace
+inline void FormatterAutomaton::handle_escape_number(int c) {
+    if (number_.accept(c)) {
+        buffer_char(c);
+        if (number_.full()) finish_number();
+        return;
+    }
+    // Not a digit: the escape ends before `c` ("\x" alone stays as it is)
+    if (number_.empty()) {
+        flush_buffer();
+        state_ = State::DEFAULT;
+    } else {
+        finish_number();
+    }
+    accept(c);
+}
+
+inline void FormatterAutomaton::finish_number() {
+    clear_buffer();
+    number_.append_to(buffer_);
+    flush_buffer();
     state_ = State::DEFAULT;
-    accept(c); // reprocess non-whitespace character
 }
 
 inline void FormatterAutomaton::handle_closing_tag(int c) {
+    const TagSyntax& syntax = syntaxes_[active_];
     buffer_char(c);
     
-    if (buffer_ends_with(syntax_.close_tag)) {
+    if (buffer_ends_with(syntax.close_tag)) {
         if (format_stack_.size() > 1) {
-            buffer_remove_suffix(syntax_.close_tag.size());
+            buffer_remove_suffix(syntax.close_tag.size());
             flush_buffer();
             emit_ansi(pop_format());
             state_ = State::DEFAULT;
@@ -260,7 +429,7 @@ inline void FormatterAutomaton::handle_closing_tag(int c) {
     }
     
     // Still potentially a close tag?
-    if (syntax_.close_tag.substr(0, buffer_.size()) == std::string_view(buffer_)) {
+    if (std::string_view(syntax.close_tag).substr(0, buffer_.size()) == buffer_) {
         return; // continue matching
     }
     
@@ -271,29 +440,41 @@ inline void FormatterAutomaton::handle_closing_tag(int c) {
 
 inline void FormatterAutomaton::handle_opening_tag(int c) {
     buffer_char(c);
-    
-    // Completed open_tag?
-    if (buffer_ == syntax_.open_tag) {
+    match_opening_tag();
+}
+
+inline void FormatterAutomaton::match_opening_tag() {
+    // Completed an open_tag? If several are possible, the first one wins
+    for (uint32_t bits = open_candidates_; bits; bits &= bits - 1) {
+        size_t k = static_cast<size_t>(std::countr_zero(bits));
+        const TagSyntax& syntax = syntaxes_[k];
+        if (buffer_ != syntax.open_tag) continue;
+
         // Special case: if close_tag == open_tag and we're inside formatting,
         // this is a close tag, not an open tag
-        if (syntax_.close_tag == syntax_.open_tag && format_stack_.size() > 1) {
+        if (syntax.close_tag == syntax.open_tag && format_stack_.size() > 1) {
             clear_buffer();
             emit_ansi(pop_format());
             state_ = State::DEFAULT;
             return;
         }
-        
-        bracket_format_ = Format::empty();
-        parsed_colors_  = 0;
-        parsed_styles_  = 0;
-        state_          = State::PARSE_OPENING_BRACKET;
+
+        active_ = k;
+        specifier_.reset();
+        state_ = State::PARSE_OPENING_BRACKET;
         return;
     }
     
     // Still a partial match?
-    if (syntax_.open_tag.substr(0, buffer_.size()) == buffer_) {
-        return;
+    uint32_t remaining = 0;
+    for (uint32_t bits = open_candidates_; bits; bits &= bits - 1) {
+        size_t k = static_cast<size_t>(std::countr_zero(bits));
+        if (std::string_view(syntaxes_[k].open_tag).substr(0, buffer_.size()) == buffer_) {
+            remaining |= uint32_t{1} << k;
+        }
     }
+    open_candidates_ = remaining;
+    if (remaining) return;
     
     // No longer matches - flush and reset
     flush_buffer();
@@ -301,26 +482,35 @@ inline void FormatterAutomaton::handle_opening_tag(int c) {
 }
 
 inline void FormatterAutomaton::handle_opening_bracket(int c) {
+    const TagSyntax& syntax = syntaxes_[active_];
     buffer_char(c);
 
     // Check for opening tag completion (e.g., "--" in "{r*--")
-    if (buffer_ends_with(syntax_.open_end)) {
-        emit_ansi(push_format(bracket_format_));
+    if (buffer_ends_with(syntax.open_end)) {
+        emit_ansi(push_format(specifier_.format()));
+        if (observer_) {
+            std::string_view spec(buffer_);
+            spec.remove_prefix(syntax.open_tag.size());
+            spec.remove_suffix(syntax.open_end.size());
+            observer_->tag(spec, format_stack_.size() - 1);
+        }
         finish_bracket_parse(true);
+        ++tags_;
         return;
     }
 
     // Check for close tag that starts with open_tag (e.g., [/] starts with [)
-    if (syntax_.close_tag.size() >= syntax_.open_tag.size() &&
-        syntax_.close_tag.substr(0, syntax_.open_tag.size()) == syntax_.open_tag) {
+    std::string_view close_tag(syntax.close_tag);
+    if (close_tag.size() >= syntax.open_tag.size() &&
+        close_tag.substr(0, syntax.open_tag.size()) == syntax.open_tag) {
         
-        size_t close_prefix_len = std::min(buffer_.size(), syntax_.close_tag.size());
-        if (close_prefix_len >= syntax_.open_tag.size() + 1 &&
-            buffer_.substr(buffer_.size() - close_prefix_len) == syntax_.close_tag.substr(0, close_prefix_len)) {
+        size_t close_prefix_len = std::min(buffer_.size(), close_tag.size());
+        if (close_prefix_len >= syntax.open_tag.size() + 1 &&
+            std::string_view(buffer_).substr(buffer_.size() - close_prefix_len) == close_tag.substr(0, close_prefix_len)) {
             
             state_ = State::PARSE_CLOSING_TAG;
-            if (buffer_ends_with(syntax_.close_tag) && format_stack_.size() > 1) {
-                buffer_remove_suffix(syntax_.close_tag.size());
+            if (buffer_ends_with(syntax.close_tag) && format_stack_.size() > 1) {
+                buffer_remove_suffix(syntax.close_tag.size());
                 flush_buffer();
                 emit_ansi(pop_format());
                 state_ = State::DEFAULT;
@@ -330,12 +520,12 @@ inline void FormatterAutomaton::handle_opening_bracket(int c) {
     }
 
     // Could be partial open_end delimiter?
-    if (could_match_prefix(syntax_.open_end)) {
+    if (could_match_prefix(syntax.open_end)) {
         return;
     }
 
     // Try parsing as format specifier
-    if (try_parse_color(c) || try_parse_style(c)) {
+    if (specifier_.accept(c)) {
         return;
     }
 
@@ -344,56 +534,31 @@ inline void FormatterAutomaton::handle_opening_bracket(int c) {
 }
 
 inline void FormatterAutomaton::handle_default(int c) {
+    buffer_char(c);
+    close_state_ = syntaxes_.step(close_state_, static_cast<uint8_t>(c));
+
     // Check for closing tag in default mode
-    std::string tentative = buffer_ + static_cast<char>(c);
-    if (tentative.size() >= syntax_.close_tag.size() &&
-        tentative.substr(tentative.size() - syntax_.close_tag.size()) == syntax_.close_tag) {
-        if (format_stack_.size() > 1) {
-            buffer_ = tentative.substr(0, tentative.size() - syntax_.close_tag.size());
-            flush_buffer();
-            emit_ansi(pop_format());
-            return;
-        }
+    int closed = syntaxes_.closed_at(close_state_);
+    if (closed >= 0 && format_stack_.size() > 1) {
+        buffer_remove_suffix(syntaxes_[static_cast<size_t>(closed)].close_tag.size());
+        flush_buffer();
+        emit_ansi(pop_format());
+        return;
     }
 
     // Check for opening tag start
-    if (c == syntax_.open_tag[0]) {
+    if (uint32_t candidates = syntaxes_.open_starting_with(static_cast<uint8_t>(c))) {
+        buffer_.pop_back();
         flush_buffer();
         buffer_char(c);
-        
-        if (syntax_.open_tag.size() == 1) {
-            // Special case: if close_tag == open_tag and we're inside formatting,
-            // this is a close tag, not an open tag
-            if (syntax_.close_tag == syntax_.open_tag && format_stack_.size() > 1) {
-                clear_buffer();
-                emit_ansi(pop_format());
-                return;
-            }
-            
-            bracket_format_ = Format::empty();
-            parsed_colors_  = 0;
-            parsed_styles_  = 0;
-            state_          = State::PARSE_OPENING_BRACKET;
-        } else {
-            state_ = State::PARSE_OPENING_TAG;
-        }
+        open_candidates_ = candidates;
+        state_           = State::PARSE_OPENING_TAG;
+        match_opening_tag();
         return;
     }
 
-    // Regular character - add to buffer
-    buffer_char(c);
-    
-    // Check for partial close tag match
-    if (buffer_ends_with(syntax_.close_tag)) {
-        if (format_stack_.size() > 1) {
-            buffer_remove_suffix(syntax_.close_tag.size());
-            flush_buffer();
-            emit_ansi(pop_format());
-            return;
-        }
-    }
-    
-    if (could_match_prefix(syntax_.close_tag)) {
+    // Regular character - wait if it may start a close tag
+    if (close_state_ != SyntaxSet::ROOT) {
         return; // wait for more characters
     }
 
@@ -401,11 +566,23 @@ inline void FormatterAutomaton::handle_default(int c) {
 }
 
 inline void FormatterAutomaton::accept(int c) {
+    if (finished_) return;
+
+    // After \#: whitespace is consumed, anything else is processed as usual
+    if (state_ == State::SKIP_WHITESPACE) {
+        if (escape::SPACE[static_cast<uint8_t>(c)]) return;
+        state_ = State::DEFAULT;
+    }
+
     // Escape sequence handling
     if (state_ == State::PARSE_ESCAPE) {
         handle_escape(c);
         return;
     }
+    if (state_ == State::PARSE_ESCAPE_NUMBER) {
+        handle_escape_number(c);
+        return;
+    }
 
     // Start escape sequence?
     if (escape_ && c == syntax::ESCAPE_CHAR) {
@@ -417,9 +594,6 @@ inline void FormatterAutomaton::accept(int c) {
 
     // Dispatch to state handler
     switch (state_) {
-    case State::SKIP_WHITESPACE:
-        handle_skip_whitespace(c);
-        break;
     case State::PARSE_CLOSING_TAG:
         handle_closing_tag(c);
         break;
@@ -435,3 +609,94 @@ inline void FormatterAutomaton::accept(int c) {
         break;
     }
 }
+
+inline void FormatterAutomaton::accept_text(std::string_view text) {
+    if (finished_) return;
+    if (state_ == State::PARSE_ESCAPE_NUMBER && !number_.empty()) {
+        finish_number();
+    } else {
+        flush_buffer();
+    }
+    specifier_.reset();
+    state_ = State::DEFAULT;
+    emit_text(text);
+}
+
+inline size_t FormatterAutomaton::skip_text(std::string_view input) const {
+    if (state_ != State::DEFAULT || !buffer_.empty() || finished_) return 0;
+    size_t n = 0;
+    while (n < input.size() && plain_[static_cast<uint8_t>(input[n])]) ++n;
+    return n;
+}
+
+inline void FormatterAutomaton::accept(std::string_view input) {
+    if (observer_) { // every escape goes through handle_escape()
+        for (char c : input) accept(static_cast<unsigned char>(c));
+        return;
+    }
+    // Text up to the next tag or escape. Bytes of close tags are text too
+    // when what follows shows they do not end one (the '-' in "2024-05"),
+    // as handle_default() would decide; the span stops before the first
+    // byte that is still undecided.
+    auto plain_span = [this](std::string_view text) {
+        size_t n = 0, end = 0;
+        int32_t state = SyntaxSet::ROOT;
+        while (n < text.size()) {
+            auto c = static_cast<uint8_t>(text[n]);
+            if (state == SyntaxSet::ROOT && plain_[c]) {
+                end = ++n;
+                continue;
+            }
+            if (opens_[c]) break;
+            state = syntaxes_.step(state, c);
+            if (syntaxes_.closed_at(state) >= 0) break;
+            ++n;
+            if (state == SyntaxSet::ROOT) end = n;
+        }
+        return end;
+    };
+    auto char_escape = [this](std::string_view text) {
+        return escape_ && text.size() >= 2 && text[0] == syntax::ESCAPE_CHAR &&
+               escape::TABLE[static_cast<uint8_t>(text[1])].kind == escape::Kind::CHAR;
+    };
+
+    while (!input.empty() && !finished_) {
+        if (state_ == State::SKIP_WHITESPACE) {
+            size_t n = escape::skip_whitespace(input);
+            input.remove_prefix(n);
+            if (!input.empty()) state_ = State::DEFAULT;
+            continue;
+        }
+
+        // Spans only start between tags, with nothing held back
+        if (state_ != State::DEFAULT || !buffer_.empty()) {
+            accept(static_cast<unsigned char>(input[0]));
+            input.remove_prefix(1);
+            continue;
+        }
+
+        size_t n = plain_span(input);
+        if (n && !char_escape(input.substr(n))) {
+            emit_text(input.substr(0, n));
+            input.remove_prefix(n);
+        } else if (n || char_escape(input)) {
+            // Text mixed with escapes like \t and \n: decode into one span
+            decoded_.clear();
+            while (true) {
+                if (char_escape(input)) {
+                    decoded_ += escape::TABLE[static_cast<uint8_t>(input[1])].value;
+                    input.remove_prefix(2);
+                } else if ((n = plain_span(input))) {
+                    decoded_.append(input.substr(0, n));
+                    input.remove_prefix(n);
+                } else {
+                    break;
+                }
+            }
+            emit_text(decoded_);
+        } else {
+            accept(static_cast<unsigned char>(input[0]));
+            input.remove_prefix(1);
+        }
+    }
+}
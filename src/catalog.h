@@ -0,0 +1,190 @@
+// catalog.h - Message catalogs compiled into pre-rendered C headers
+#pragma once
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "alphabet.h"
+#include "automaton.h"
+#include "config_file.h"
+#include "palette.h"
+#include "sink.h"
+#include "syntax_set.h"
+#include "unicode.h"
+
+// Fixed messages ("ID = tagged text" lines) rendered once, ahead of time,
+// for consumers that cannot render at run time: C99, pre-C++20, embedded.
+// emit_header() writes each message as it would be printed by the CLI given
+// the same text as an argument, plus the stripped text and its width.
+class MessageCatalog {
+public:
+    struct Message {
+        std::string id;
+        std::string text;
+    };
+
+    // IDs must be C identifiers and unique; false and `error` otherwise
+    bool add(std::string_view id, std::string_view text, std::string& error);
+
+    // Read "ID = TEXT" lines: spaces around ID and TEXT are trimmed, blank
+    // lines and lines starting with '#' are skipped. Returns false and fills
+    // `error` on the first invalid line.
+    bool load(FILE* file, std::string& error);
+
+    size_t size() const { return messages_.size(); }
+    const std::vector<Message>& messages() const { return messages_; }
+
+    // A C header defining ID_ANSI, ID_PLAIN (string literals) and ID_WIDTH
+    // (columns of the widest line) for every message, in catalog order
+    std::string emit_header(std::string_view guard, const SyntaxSet& syntaxes = TagSyntax::CLASSIC,
+                            bool escape = false, bool sanitize = true,
+                            const Palette& palette = Palette::standard(),
+                            const SpecifierAlphabet& alphabet = SpecifierAlphabet::standard()) const;
+
+    // Include guard for a header generated from `path`: "msgs.txt" -> "MSGS_TXT_H"
+    static std::string guard_for(std::string_view path);
+
+private:
+    std::vector<Message> messages_;
+
+    static std::string render(std::string_view text, bool strip, const SyntaxSet& syntaxes, bool escape,
+                              bool sanitize, const Palette& palette, const SpecifierAlphabet& alphabet);
+    static size_t widest_line(std::string_view plain);
+    static void append_literal(std::string& out, std::string_view bytes);
+};
+
+// Implementation
+
+inline bool MessageCatalog::add(std::string_view id, std::string_view text, std::string& error) {
+    auto identifier_char = [](char c) {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+    };
+    if (id.empty() || (id[0] >= '0' && id[0] <= '9') || !std::all_of(id.begin(), id.end(), identifier_char)) {
+        error = "'" + std::string(id) + "' is not a C identifier";
+        return false;
+    }
+    for (const Message& m : messages_) {
+        if (m.id == id) {
+            error = "duplicate ID '" + std::string(id) + "'";
+            return false;
+        }
+    }
+    messages_.push_back({std::string(id), std::string(text)});
+    return true;
+}
+
+inline bool MessageCatalog::load(FILE* file, std::string& error) {
+    auto trim = [](std::string_view s) {
+        size_t first = s.find_first_not_of(" \t");
+        if (first == std::string_view::npos) return std::string_view();
+        return s.substr(first, s.find_last_not_of(" \t") - first + 1);
+    };
+
+    return read_config_lines(file, error, [&](std::string_view line, std::string& why) {
+        std::string_view entry = trim(line);
+        size_t equals          = entry.find('=');
+        if (equals == std::string_view::npos) {
+            why = "expected 'ID = TEXT', got '" + std::string(line) + "'";
+            return false;
+        }
+        return add(trim(entry.substr(0, equals)), trim(entry.substr(equals + 1)), why);
+    });
+}
+
+inline std::string MessageCatalog::emit_header(std::string_view guard, const SyntaxSet& syntaxes, bool escape,
+                                               bool sanitize, const Palette& palette,
+                                               const SpecifierAlphabet& alphabet) const {
+    std::string out;
+    out += "/* Generated by formatter --emit-header; do not edit. */\n";
+    out += "#ifndef ";
+    out += guard;
+    out += "\n#define ";
+    out += guard;
+    out += "\n";
+
+    for (const Message& m : messages_) {
+        std::string plain = render(m.text, true, syntaxes, escape, sanitize, palette, alphabet);
+
+        out += "\n#define " + m.id + "_ANSI  ";
+        append_literal(out, render(m.text, false, syntaxes, escape, sanitize, palette, alphabet));
+        out += "\n#define " + m.id + "_PLAIN ";
+        append_literal(out, plain);
+        out += "\n#define " + m.id + "_WIDTH " + std::to_string(widest_line(plain)) + "\n";
+    }
+
+    out += "\n#endif /* ";
+    out += guard;
+    out += " */\n";
+    return out;
+}
+
+inline std::string MessageCatalog::guard_for(std::string_view path) {
+    size_t slash = path.find_last_of('/');
+    std::string_view name = slash == std::string_view::npos ? path : path.substr(slash + 1);
+
+    std::string guard;
+    if (name.empty() || (name[0] >= '0' && name[0] <= '9')) guard += "CATALOG_";
+    for (char c : name) {
+        if (c >= 'a' && c <= 'z') {
+            guard += static_cast<char>(c - 'a' + 'A');
+        } else if ((c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')) {
+            guard += c;
+        } else {
+            guard += '_';
+        }
+    }
+    return guard + "_H";
+}
+
+inline std::string MessageCatalog::render(std::string_view text, bool strip, const SyntaxSet& syntaxes,
+                                          bool escape, bool sanitize, const Palette& palette,
+                                          const SpecifierAlphabet& alphabet) {
+    std::string result;
+    StringSink out(result);
+    FormatterAutomaton automaton(strip, escape, sanitize, syntaxes, out, palette, alphabet);
+    automaton.accept(text);
+    automaton.finish();
+    return result;
+}
+
+inline size_t MessageCatalog::widest_line(std::string_view plain) {
+    size_t widest = 0;
+    unicode::WidthCounter counter;
+    for (char c : plain) {
+        if (c == '\n') {
+            widest = std::max(widest, counter.final_width());
+            counter.reset();
+        } else {
+            counter.put(c);
+        }
+    }
+    return std::max(widest, counter.final_width());
+}
+
+// As a C string literal; bytes other than printable ASCII become 3-digit
+// octal escapes, which no following digit can extend
+inline void MessageCatalog::append_literal(std::string& out, std::string_view bytes) {
+    out += '"';
+    char prev = 0;
+    for (char c : bytes) {
+        auto byte = static_cast<unsigned char>(c);
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (c == '?' && prev == '?') {
+            out += "\\?"; // no trigraphs
+        } else if (byte >= 0x20 && byte < 0x7f) {
+            out += c;
+        } else {
+            out += '\\';
+            out += static_cast<char>('0' + (byte >> 6));
+            out += static_cast<char>('0' + ((byte >> 3) & 7));
+            out += static_cast<char>('0' + (byte & 7));
+        }
+        prev = c;
+    }
+    out += '"';
+}
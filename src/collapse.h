@@ -0,0 +1,119 @@
+// collapse.h - Collapse carriage-return progress updates
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#include "ansi.h"
+#include "sink.h"
+
+// Sink decorator for output that redraws a line with '\r' (progress bars).
+//
+// Without throttling (output is not a terminal) a segment overwritten by the
+// next '\r' is dropped, so each line appears once, in its final state. With
+// throttling (a terminal) an overwritten segment is still drawn if at least
+// one frame interval has passed since the previous redraw, each redraw
+// erases the line first (a shorter frame leaves nothing behind), and idle()
+// draws the latest frame when input pauses.
+//
+// Dropped segments keep their SGR sequences, so the format state carries over.
+class CollapseSink : public Sink {
+public:
+    // Lines that never end are passed through once they grow this long
+    static constexpr size_t MAX_LINE = 64 * 1024;
+
+    CollapseSink(Sink& out, bool throttle, unsigned fps = 30)
+        : out_(out), throttle_(throttle),
+          frame_(std::chrono::microseconds(1000000 / (fps ? fps : 1))) {}
+
+    void write(std::string_view text) override {
+        for (char c : text) put(c);
+    }
+
+    void put(char c) override {
+        if (after_cr_ && c != '\r') {
+            if (c != '\n') end_segment();
+            after_cr_ = false;
+        }
+        if (c == '\r') after_cr_ = true;
+
+        line_ += c;
+        if (c == '\n' || (line_.size() >= MAX_LINE && !after_cr_)) {
+            commit();
+        }
+    }
+
+    void flush() override {
+        commit();
+        out_.flush();
+    }
+
+    // Input has paused: with throttling, draw the segment being written and
+    // push it out, so the terminal does not show a stale frame meanwhile
+    void idle() {
+        if (!throttle_ || line_.empty()) return;
+        last_draw_ = std::chrono::steady_clock::now();
+        commit();
+        out_.flush();
+    }
+
+private:
+    Sink& out_;
+    const bool throttle_;
+    const std::chrono::steady_clock::duration frame_;
+    std::chrono::steady_clock::time_point last_draw_{};
+
+    std::string line_;     // current line since the last committed point
+    bool after_cr_ = false; // line_ ends with '\r' (possibly several)
+    bool drawn_    = false; // part of the current line is committed already
+
+    void commit() {
+        if (line_.empty()) return;
+        drawn_ = line_.back() != '\n';
+        out_.write(line_);
+        line_.clear();
+    }
+
+    // A new segment starts after '\r': draw or drop the previous one
+    void end_segment() {
+        if (throttle_) {
+            auto now = std::chrono::steady_clock::now();
+            if (now - last_draw_ >= frame_) {
+                last_draw_ = now;
+                commit();
+                out_.write(ansi::ERASE_LINE);
+                return;
+            }
+        }
+        drop_segment();
+        // What is on screen of this line is overwritten from its start
+        if (drawn_) {
+            line_ += '\r';
+            if (throttle_) line_ += ansi::ERASE_LINE;
+        }
+    }
+
+    // Replace line_ with just its SGR sequences. Anything before an SGR that
+    // starts with a reset (0) is irrelevant and dropped too.
+    void drop_segment() {
+        size_t kept = 0;
+        for (size_t i = 0; i < line_.size(); ++i) {
+            size_t len = ansi::csi_length(std::string_view(line_).substr(i));
+            if (!len) {
+                if (line_[i] == '\e' && i + 1 < line_.size() && line_[i + 1] == '[') break; // incomplete
+                continue;
+            }
+
+            std::string_view seq(line_.data() + i, len);
+            if (seq.back() == ansi::ESC_END) {
+                if (ansi::sgr_resets(seq)) kept = 0;
+                std::char_traits<char>::move(line_.data() + kept, seq.data(), len);
+                kept += len;
+            }
+            i += len - 1;
+        }
+        line_.resize(kept);
+    }
+};
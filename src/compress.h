@@ -0,0 +1,213 @@
+// compress.h - Compress output in-process (gzip, zstd)
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+
+#include "sink.h"
+
+// Formats are compiled in on request: define FORMATTER_WITH_ZLIB and link
+// -lz, define FORMATTER_WITH_ZSTD and link -lzstd (the Makefile does both
+// for the libraries it finds, see WITH_ZLIB and WITH_ZSTD there)
+#ifdef FORMATTER_WITH_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef FORMATTER_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+// Sink decorator that compresses everything written to it, so archives need
+// no separate compressor behind a pipe. Writes of at least STAGE bytes go to
+// the encoder as they are; smaller ones are collected up to STAGE bytes
+// first, so the encoder is not called per character. The encoder writes
+// into the next sink's buffer when it lends one (FdSink does, see
+// Sink::reserve()), else into a block of its own that is then written on.
+//
+// flush() makes everything written so far decodable (a sync flush) without
+// ending the stream; finish() ends it and is called on destruction at the
+// latest. Output cut short (a signal, for example) is only decodable to the
+// end if finish() still runs; the formatter makes sure it does.
+class CompressSink : public Sink {
+public:
+    enum class Format { GZIP, ZSTD };
+
+    static constexpr size_t STAGE      = 16 * 1024;  // writes smaller than this are collected
+    static constexpr size_t MIN_OUTPUT = 16 * 1024;  // room asked of the next sink per call
+    static constexpr size_t BLOCK      = 256 * 1024; // own output block, when the sink lends none
+
+    static bool supported(Format format);
+
+    // `format` must be supported(); failed() reports a compressor error
+    CompressSink(Sink& out, Format format);
+    ~CompressSink() override;
+
+    CompressSink(const CompressSink&)            = delete;
+    CompressSink& operator=(const CompressSink&) = delete;
+
+    void write(std::string_view text) override {
+        if (staged_.size() + text.size() < STAGE) {
+            staged_ += text;
+            return;
+        }
+        encode_staged(Mode::CONTINUE);
+        encode(text, Mode::CONTINUE);
+    }
+
+    void put(char c) override {
+        staged_ += c;
+        if (staged_.size() >= STAGE) encode_staged(Mode::CONTINUE);
+    }
+
+    void flush() override {
+        if (!finished_ && (dirty_ || !staged_.empty())) encode_staged(Mode::FLUSH);
+        out_.flush();
+    }
+
+    void finish() {
+        if (finished_) return;
+        encode_staged(Mode::END);
+        finished_ = true;
+        out_.flush();
+    }
+
+    bool failed() const { return failed_; }
+
+private:
+    enum class Mode { CONTINUE, FLUSH, END };
+
+    Sink& out_;
+    const Format format_;
+    std::string staged_;             // small writes not yet encoded
+    std::unique_ptr<char[]> block_;  // own output space, allocated when first needed
+    bool lent_     = false;          // the last output space came from out_
+    bool dirty_    = false;          // input encoded since the last flush
+    bool finished_ = false;
+    bool failed_   = false;
+
+#ifdef FORMATTER_WITH_ZLIB
+    z_stream zlib_{};
+#endif
+#ifdef FORMATTER_WITH_ZSTD
+    ZSTD_CCtx* zstd_ = nullptr;
+#endif
+
+    void encode_staged(Mode mode) {
+        if (staged_.empty() && mode == Mode::CONTINUE) return;
+        encode(staged_, mode);
+        staged_.clear();
+    }
+
+    void encode(std::string_view input, Mode mode);
+    void encode_zlib(std::string_view input, Mode mode);
+    void encode_zstd(std::string_view input, Mode mode);
+
+    // Where the encoder writes next, and handing on what it wrote there
+    std::span<char> output_space() {
+        std::span<char> space = out_.reserve(MIN_OUTPUT);
+        lent_                 = !space.empty();
+        if (lent_) return space;
+        if (!block_) block_.reset(new char[BLOCK]);
+        return {block_.get(), BLOCK};
+    }
+
+    void output_done(std::span<char> space, size_t len) {
+        if (lent_) {
+            out_.commit(len);
+        } else {
+            out_.write(std::string_view(space.data(), len));
+        }
+    }
+};
+
+// Implementation
+
+inline bool CompressSink::supported(Format format) {
+    switch (format) {
+#ifdef FORMATTER_WITH_ZLIB
+    case Format::GZIP: return true;
+#endif
+#ifdef FORMATTER_WITH_ZSTD
+    case Format::ZSTD: return true;
+#endif
+    default: return false;
+    }
+}
+
+inline CompressSink::CompressSink(Sink& out, Format format) : out_(out), format_(format) {
+    staged_.reserve(STAGE);
+    failed_ = !supported(format);
+#ifdef FORMATTER_WITH_ZLIB
+    if (format == Format::GZIP) {
+        // 15 bits of window, +16 for a gzip header and trailer
+        failed_ = deflateInit2(&zlib_, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK;
+    }
+#endif
+#ifdef FORMATTER_WITH_ZSTD
+    if (format == Format::ZSTD) {
+        zstd_   = ZSTD_createCCtx();
+        failed_ = !zstd_;
+    }
+#endif
+}
+
+inline CompressSink::~CompressSink() {
+    finish();
+#ifdef FORMATTER_WITH_ZLIB
+    if (format_ == Format::GZIP) deflateEnd(&zlib_);
+#endif
+#ifdef FORMATTER_WITH_ZSTD
+    ZSTD_freeCCtx(zstd_);
+#endif
+}
+
+inline void CompressSink::encode(std::string_view input, Mode mode) {
+    if (!failed_) {
+        if (format_ == Format::GZIP) {
+            encode_zlib(input, mode);
+        } else {
+            encode_zstd(input, mode);
+        }
+    }
+    dirty_ = mode == Mode::CONTINUE;
+}
+
+inline void CompressSink::encode_zlib([[maybe_unused]] std::string_view input, [[maybe_unused]] Mode mode) {
+#ifdef FORMATTER_WITH_ZLIB
+    static constexpr int FLUSH[] = {Z_NO_FLUSH, Z_SYNC_FLUSH, Z_FINISH};
+    zlib_.next_in  = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+    zlib_.avail_in = static_cast<uInt>(input.size());
+    do {
+        std::span<char> space = output_space();
+        zlib_.next_out        = reinterpret_cast<Bytef*>(space.data());
+        zlib_.avail_out       = static_cast<uInt>(space.size());
+        int result            = deflate(&zlib_, FLUSH[static_cast<int>(mode)]);
+        output_done(space, space.size() - zlib_.avail_out);
+        if (result == Z_STREAM_ERROR) {
+            failed_ = true;
+            return;
+        }
+    } while (zlib_.avail_out == 0);
+#endif
+}
+
+inline void CompressSink::encode_zstd([[maybe_unused]] std::string_view input, [[maybe_unused]] Mode mode) {
+#ifdef FORMATTER_WITH_ZSTD
+    static constexpr ZSTD_EndDirective END[] = {ZSTD_e_continue, ZSTD_e_flush, ZSTD_e_end};
+    ZSTD_inBuffer in{input.data(), input.size(), 0};
+    size_t remaining;
+    do {
+        std::span<char> space = output_space();
+        ZSTD_outBuffer out{space.data(), space.size(), 0};
+        remaining = ZSTD_compressStream2(zstd_, &out, &in, END[static_cast<int>(mode)]);
+        output_done(space, ZSTD_isError(remaining) ? 0 : out.pos);
+        if (ZSTD_isError(remaining)) {
+            failed_ = true;
+            return;
+        }
+    } while (mode == Mode::CONTINUE ? in.pos < in.size : remaining != 0);
+#endif
+}
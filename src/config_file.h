@@ -0,0 +1,35 @@
+// config_file.h - Reading line-based configuration files
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+// Call `parse(line, why)` for each line of `file`, without its "\n" or
+// "\r\n". Blank lines and lines whose first non-blank character is '#' are
+// skipped. Returns false at the first line `parse` rejects, with "line N: "
+// and its `why` in `error`.
+template <typename ParseFn>
+bool read_config_lines(FILE* file, std::string& error, ParseFn&& parse) {
+    std::string line;
+    std::string why;
+    int line_no = 0;
+    int c;
+    do {
+        c = std::getc(file);
+        if (c != '\n' && c != EOF) {
+            line += static_cast<char>(c);
+            continue;
+        }
+        ++line_no;
+
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        size_t first = line.find_first_not_of(" \t");
+        if (first != std::string::npos && line[first] != '#' && !parse(std::string_view(line), why)) {
+            error = "line " + std::to_string(line_no) + ": " + why;
+            return false;
+        }
+        line.clear();
+    } while (c != EOF);
+    return true;
+}
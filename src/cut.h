@@ -0,0 +1,149 @@
+// cut.h - Truncate rendered lines to a number of columns
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#include "ansi.h"
+#include "automaton.h"
+#include "sink.h"
+#include "tag_syntax.h"
+#include "unicode.h"
+
+// Sink decorator that truncates every line to a display width. Visible text
+// past the budget is dropped, while escape sequences always pass, so tags
+// closed after the cut still restore the format and the final reset is kept.
+//
+// With an ellipsis, a line that does not fit is cut short enough for the
+// ellipsis to fit too; text that may have to give way to it is held until
+// the line either ends or overflows.
+class CutSink : public Sink {
+public:
+    CutSink(Sink& out, size_t columns, std::string_view ellipsis = {})
+        : out_(out), columns_(columns), ellipsis_(ellipsis) {
+        unicode::WidthCounter counter;
+        counter.write(ellipsis);
+        size_t ellipsis_width = counter.final_width();
+        keep_ = ellipsis_width < columns ? columns - ellipsis_width : 0;
+    }
+
+    void write(std::string_view text) override {
+        for (char c : text) put(c);
+    }
+
+    void put(char c) override {
+        unit_ += c;
+        counter_.put(c);
+        if (counter_.in_sequence()) return; // rest of the character or escape
+        accept_unit();
+        unit_.clear();
+    }
+
+    // The current line has used up its columns and no character is half
+    // written: text up to the line end would be dropped
+    bool full() const { return overflowed_ && unit_.empty(); }
+
+    void flush() override {
+        if (!unit_.empty()) {
+            accept_unit(); // input ended mid-character
+            unit_.clear();
+        }
+        end_line();
+        out_.flush();
+    }
+
+private:
+    Sink& out_;
+    const size_t columns_;
+    const std::string ellipsis_;
+    size_t keep_; // columns left for text when the ellipsis is shown
+
+    unicode::WidthCounter counter_; // columns used on the current line
+    std::string unit_;              // bytes of the current character or escape
+    std::string held_;              // output that may have to give way to the ellipsis
+    bool overflowed_ = false;       // the current line has been cut
+
+    // A complete character, control character or escape sequence
+    void accept_unit() {
+        if (unit_[0] == '\e') {
+            if (held_.empty()) {
+                out_.write(unit_);
+            } else {
+                held_ += unit_;
+            }
+            return;
+        }
+        if (unit_ == "\n" || unit_ == "\r") {
+            end_line();
+            out_.write(unit_);
+            return;
+        }
+        if (overflowed_) return;
+
+        if (counter_.width() > columns_) {
+            overflow();
+        } else if (!held_.empty() || counter_.width() > keep_) {
+            held_ += unit_;
+        } else {
+            out_.write(unit_);
+        }
+    }
+
+    // Drop held text in favour of the ellipsis, keeping its escapes
+    void overflow() {
+        out_.write(ellipsis_);
+        std::string_view held(held_);
+        for (size_t i = 0; i < held.size(); ++i) {
+            size_t len = ansi::csi_length(held.substr(i));
+            if (len) {
+                out_.write(held.substr(i, len));
+                i += len - 1;
+            }
+        }
+        held_.clear();
+        overflowed_ = true;
+    }
+
+    void end_line() {
+        out_.write(held_);
+        held_.clear();
+        counter_.reset();
+        overflowed_ = false;
+    }
+};
+
+// Render `text` with every line cut to `columns`, e.g. for a fixed-width UI.
+// Once a line is full, only the tags and escape sequences in the rest of it
+// are processed.
+inline std::string render_cut(std::string_view text, size_t columns, std::string_view ellipsis = {},
+                              const TagSyntax& syntax = TagSyntax::CLASSIC) {
+    std::string result;
+    StringSink out(result);
+    CutSink cut(out, columns, ellipsis);
+    {
+        FormatterAutomaton automaton(false, false, true, syntax, cut);
+        const size_t chunk = columns + 1;            // input rendered between checks of the budget
+        size_t stop        = std::string_view::npos; // next line end or raw escape, once looked up
+        for (size_t i = 0; i < text.size();) {
+            size_t len = 0;
+            if (cut.full()) {
+                if (stop == std::string_view::npos || stop < i) {
+                    stop = std::min(text.find_first_of("\r\n\e", i), text.size());
+                }
+                len = automaton.skip_text(text.substr(i, stop - i));
+                if (!len) { // inside a tag, or at `stop`
+                    len = 1;
+                    automaton.accept(static_cast<unsigned char>(text[i]));
+                }
+            } else {
+                len = std::min(chunk, text.size() - i);
+                automaton.accept(text.substr(i, len));
+            }
+            i += len;
+        }
+    }
+    cut.flush();
+    return result;
+}
@@ -0,0 +1,152 @@
+// escape.h - C-like escape sequences (-e mode)
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "syntax.h"
+
+namespace escape {
+
+// What the character after the backslash starts
+enum class Kind : uint8_t {
+    INVALID, // not an escape: both characters are printed
+    CHAR,    // single character: \n, \t, \e, \\ ...
+    HEX,     // \xHH: one or two hex digits
+    UNICODE, // \uXXXX: one to four hex digits, written as UTF-8
+    OCTAL,   // \NNN: one to three octal digits, up to \377
+    TRIM,    // \#: skip the whitespace that follows
+};
+
+struct Entry {
+    Kind kind  = Kind::INVALID;
+    char value = 0; // the character a CHAR escape stands for
+};
+
+// Indexed by the byte after the backslash
+inline constexpr std::array<Entry, 256> TABLE = [] {
+    std::array<Entry, 256> table{};
+    constexpr struct { char name; char value; } CHARS[] = {
+        {syntax::ESCAPE_CHAR, syntax::ESCAPE_CHAR},
+        {'a', '\a'}, {'b', '\b'}, {'e', '\x1b'}, {'f', '\f'},
+        {'n', '\n'}, {'r', '\r'}, {'t', '\t'}, {'v', '\v'},
+    };
+    for (auto [name, value] : CHARS) {
+        table[static_cast<uint8_t>(name)] = {Kind::CHAR, value};
+    }
+    for (char c = '0'; c <= '7'; ++c) {
+        table[static_cast<uint8_t>(c)] = {Kind::OCTAL, 0};
+    }
+    table['x']                                        = {Kind::HEX, 0};
+    table['u']                                        = {Kind::UNICODE, 0};
+    table[static_cast<uint8_t>(syntax::TRIM_ESCAPE)] = {Kind::TRIM, 0};
+    return table;
+}();
+
+// Whitespace the \# escape skips: what isspace() means in the C locale,
+// whatever locale the program runs in
+inline constexpr std::array<bool, 256> SPACE = [] {
+    std::array<bool, 256> table{};
+    for (char c : {' ', '\t', '\n', '\v', '\f', '\r'}) table[static_cast<uint8_t>(c)] = true;
+    return table;
+}();
+
+// Length of the whitespace run `text` starts with; 16 bytes per step where
+// SSE2 is available (always on x86-64)
+inline size_t skip_whitespace(std::string_view text) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128i space    = _mm_set1_epi8(' ');
+    const __m128i tab      = _mm_set1_epi8('\t');
+    const __m128i carriage = _mm_set1_epi8('\r');
+    for (; i + 16 <= text.size(); i += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text.data() + i));
+        // '\t'..'\r' are contiguous: a byte is in range if clamping leaves it unchanged
+        __m128i controls = _mm_cmpeq_epi8(_mm_min_epu8(_mm_max_epu8(bytes, tab), carriage), bytes);
+        __m128i spaces   = _mm_or_si128(controls, _mm_cmpeq_epi8(bytes, space));
+        auto mask        = static_cast<unsigned>(_mm_movemask_epi8(spaces));
+        if (mask != 0xffff) return i + static_cast<size_t>(__builtin_ctz(~mask));
+    }
+#endif
+    while (i < text.size() && SPACE[static_cast<uint8_t>(text[i])]) ++i;
+    return i;
+}
+
+// Digits of a numeric escape, collected one at a time
+class Number {
+public:
+    void start(Kind kind) {
+        kind_   = kind;
+        value_  = 0;
+        digits_ = 0;
+    }
+
+    // Take `c` as the next digit; false if it is not one (or one too many)
+    bool accept(int c) {
+        int digit = kind_ == Kind::OCTAL ? octal_digit(c) : hex_digit(c);
+        if (digit < 0 || full()) return false;
+        uint32_t value = value_ * (kind_ == Kind::OCTAL ? 8 : 16) + static_cast<uint32_t>(digit);
+        if (kind_ == Kind::OCTAL && value > 0377) return false;
+        value_ = value;
+        ++digits_;
+        return true;
+    }
+
+    bool empty() const { return digits_ == 0; }
+    bool full() const { return digits_ == max_digits(); }
+
+    // The decoded character: one byte, or UTF-8 for \u
+    void append_to(std::string& out) const {
+        if (kind_ != Kind::UNICODE) {
+            out += static_cast<char>(value_);
+        } else {
+            append_utf8(out, value_);
+        }
+    }
+
+private:
+    Kind kind_      = Kind::HEX;
+    uint32_t value_ = 0;
+    int digits_     = 0;
+
+    int max_digits() const {
+        switch (kind_) {
+        case Kind::HEX:     return 2;
+        case Kind::UNICODE: return 4;
+        default:            return 3;
+        }
+    }
+
+    static int octal_digit(int c) { return c >= '0' && c <= '7' ? c - '0' : -1; }
+
+    static int hex_digit(int c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    // Surrogates are not characters; they become U+FFFD
+    static void append_utf8(std::string& out, uint32_t cp) {
+        if (cp >= 0xd800 && cp <= 0xdfff) cp = 0xfffd;
+        if (cp < 0x80) {
+            out += static_cast<char>(cp);
+        } else if (cp < 0x800) {
+            out += static_cast<char>(0xc0 | (cp >> 6));
+            out += static_cast<char>(0x80 | (cp & 0x3f));
+        } else {
+            out += static_cast<char>(0xe0 | (cp >> 12));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3f));
+            out += static_cast<char>(0x80 | (cp & 0x3f));
+        }
+    }
+};
+
+} // namespace escape
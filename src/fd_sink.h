@@ -0,0 +1,235 @@
+// fd_sink.h - Buffered file-descriptor output that survives non-blocking fds
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <poll.h>
+#include <span>
+#include <string_view>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "sink.h"
+
+// Writes to a raw fd through a fixed-size buffer. Partial writes are resumed
+// and EAGAIN (non-blocking fd) waits in poll() instead of losing output or
+// spinning. Library users that must not block can watch backpressure() and
+// drive try_flush() from their own event loop.
+class FdSink : public Sink {
+public:
+    // When buffered output is pushed to the fd
+    enum class Flush {
+        AUTO, // LINE on a terminal, FULL otherwise (like stdio)
+        LINE, // after every newline
+        FULL, // only when the buffer fills up or on flush()
+        NONE, // after every write
+        SYNC, // only on flush() or a full buffer, as one synchronized update
+    };
+
+    static constexpr size_t DEFAULT_CAPACITY = 64 * 1024;
+
+    // DEC private mode 2026: the terminal holds painting between these, so a
+    // batch is drawn once instead of as it trickles in. Terminals that do not
+    // know the mode ignore it.
+    static constexpr std::string_view SYNC_BEGIN = "\e[?2026h";
+    static constexpr std::string_view SYNC_END   = "\e[?2026l";
+    static constexpr size_t SYNC_THRESHOLD       = 1024; // smaller batches are sent as they are
+
+    explicit FdSink(int fd, Flush policy = Flush::AUTO, size_t capacity = DEFAULT_CAPACITY)
+        : fd_(fd), capacity_(capacity ? capacity : 1), high_water_(capacity_ / 2),
+          buffer_(new char[capacity_]) {
+        if (policy == Flush::AUTO) {
+            policy = isatty(fd) ? Flush::LINE : Flush::FULL;
+        }
+        policy_       = policy;
+        synchronized_ = policy == Flush::SYNC && isatty(fd);
+    }
+
+    ~FdSink() override { flush(); }
+
+    FdSink(const FdSink&)            = delete;
+    FdSink& operator=(const FdSink&) = delete;
+
+    void write(std::string_view text) override {
+        if (failed_) return;
+
+        if (text.size() > capacity_) {
+            // Too big to buffer: drain what we have and write straight from the source
+            if (synchronized_) {
+                drain_synchronized(text, false);
+            } else {
+                flush();
+                drain(text.data(), text.size(), true);
+            }
+            return;
+        }
+
+        if (capacity_ - end_ < text.size()) make_room(text.size());
+        std::memcpy(buffer_.get() + end_, text.data(), text.size());
+        end_ += text.size();
+
+        if (policy_ == Flush::NONE ||
+            (policy_ == Flush::LINE && text.find('\n') != std::string_view::npos)) {
+            flush();
+        }
+    }
+
+    void put(char c) override {
+        if (failed_) return;
+        if (end_ == capacity_) make_room(1);
+        buffer_[end_] = c;
+        ++end_;
+
+        if (policy_ == Flush::NONE || (policy_ == Flush::LINE && c == '\n')) {
+            flush();
+        }
+    }
+
+    // Lend the free end of the buffer, making room for `min` bytes
+    std::span<char> reserve(size_t min) override {
+        if (failed_ || min > capacity_) return {};
+        if (capacity_ - end_ < min) make_room(min);
+        return {buffer_.get() + end_, capacity_ - end_};
+    }
+
+    void commit(size_t len) override {
+        if (failed_) return;
+        const char* data = buffer_.get() + end_;
+        end_ += len;
+        if (policy_ == Flush::NONE || (policy_ == Flush::LINE && std::memchr(data, '\n', len))) {
+            flush();
+        }
+    }
+
+    // Write out everything, waiting while the fd would block.
+    // If the fd fails (e.g. EPIPE) buffered data is dropped and failed() is set.
+    void flush() override {
+        if (synchronized_ && (in_update_ || pending() >= SYNC_THRESHOLD)) {
+            drain_synchronized();
+        } else {
+            begin_ += drain(buffer_.get() + begin_, pending(), true);
+        }
+        compact();
+    }
+
+    // Write out as much as the fd accepts right now, without waiting.
+    // Returns true when the buffer is empty.
+    bool try_flush() {
+        begin_ += drain(buffer_.get() + begin_, pending(), false);
+        compact();
+        return begin_ == end_;
+    }
+
+    // Backpressure signal: producers should pause while this is true
+    bool backpressure() const { return pending() >= high_water_; }
+
+    size_t pending() const { return end_ - begin_; }
+    bool failed() const { return failed_; }
+    int fd() const { return fd_; }
+    Flush policy() const { return policy_; }
+
+private:
+    const int fd_;
+    const size_t capacity_;
+    const size_t high_water_;
+    Flush policy_;
+    bool synchronized_; // SYNC on a terminal: batches get the mode 2026 sequences
+    bool in_update_ = false; // SYNC_BEGIN sent for a batch that overflowed the buffer
+    bool failed_ = false;
+
+    // Fixed allocation: buffered bytes are always buffer_[begin_, end_)
+    std::unique_ptr<char[]> buffer_;
+    size_t begin_ = 0;
+    size_t end_   = 0;
+
+    // Write [data, data+len), resuming partial writes. Returns bytes written.
+    size_t drain(const char* data, size_t len, bool wait) {
+        size_t done = 0;
+        while (done < len && !failed_) {
+            ssize_t n = ::write(fd_, data + done, len - done);
+            if (n > 0) {
+                done += static_cast<size_t>(n);
+            } else if (n < 0 && errno == EINTR) {
+                continue;
+            } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                if (!wait) break;
+                wait_writable();
+            } else {
+                failed_ = true;
+            }
+        }
+        return done;
+    }
+
+    // The buffer, then `extra`, as one synchronized update, in a single
+    // writev(2) unless the fd takes it in parts. With `close` false the update
+    // is left open: a batch larger than the buffer goes out in several drains
+    // and the terminal still paints it once, after flush() closes it.
+    void drain_synchronized(std::string_view extra = {}, bool close = true) {
+        iovec iov[4];
+        int count = 0;
+        if (!in_update_) iov[count++] = {const_cast<char*>(SYNC_BEGIN.data()), SYNC_BEGIN.size()};
+        iovec* buffered = iov + count;
+        iov[count++]    = {buffer_.get() + begin_, pending()};
+        if (!extra.empty()) iov[count++] = {const_cast<char*>(extra.data()), extra.size()};
+        if (close) iov[count++] = {const_cast<char*>(SYNC_END.data()), SYNC_END.size()};
+        in_update_ = !close;
+
+        iovec* next = iov;
+        while (count > 0 && !failed_) {
+            ssize_t n = ::writev(fd_, next, count);
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                wait_writable();
+                continue;
+            }
+            if (n <= 0) {
+                failed_ = true;
+                break;
+            }
+            // Skip what was written; the buffer's part advances begin_
+            auto done = static_cast<size_t>(n);
+            while (count > 0 && done >= next->iov_len) {
+                done -= next->iov_len;
+                if (next == buffered) begin_ = end_;
+                ++next;
+                --count;
+            }
+            if (count > 0 && done > 0) {
+                next->iov_base = static_cast<char*>(next->iov_base) + done;
+                next->iov_len -= done;
+                if (next == buffered) begin_ += done;
+            }
+        }
+    }
+
+    void wait_writable() const {
+        pollfd pfd{fd_, POLLOUT, 0};
+        while (::poll(&pfd, 1, -1) < 0 && errno == EINTR) {}
+    }
+
+    // Ensure `len` bytes fit after end_, draining and shifting as needed. In
+    // SYNC mode the drain opens (or continues) the batch's update.
+    void make_room(size_t len) {
+        if (capacity_ - pending() < len) {
+            if (synchronized_) {
+                drain_synchronized({}, false);
+            } else {
+                flush();
+            }
+        }
+        compact();
+        if (begin_ > 0) {
+            std::memmove(buffer_.get(), buffer_.get() + begin_, pending());
+            end_ -= begin_;
+            begin_ = 0;
+        }
+    }
+
+    // Reset to the start of the buffer once it is empty; a failed fd drops everything
+    void compact() {
+        if (begin_ == end_ || failed_) begin_ = end_ = 0;
+    }
+};
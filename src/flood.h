@@ -0,0 +1,184 @@
+// flood.h - Rate limiting and duplicate folding of input lines
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+// Input-side protection against log storms: lines are dropped before any
+// rendering work is spent on them, so a crash loop upstream cannot make the
+// formatter or the terminal the bottleneck.
+//
+// With `max_rate`, lines are admitted by a token bucket holding up to one
+// second's worth of lines; the others are dropped and counted, and a
+// "N lines suppressed" line is written before the next admitted one. With
+// `dedupe`, a line whose raw bytes equal the previous line's is folded into
+// a "last line repeated N times" line written before the next different
+// one. Repeats are folded before they reach the rate limit.
+//
+// Dropped lines are not rendered, so tags they open or close do not take
+// effect; a folded repeat takes effect once.
+class LineFilter {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Lines longer than this are passed on unfolded, without being held
+    static constexpr size_t MAX_LINE = 64 * 1024;
+
+    // `max_rate` in lines per second, 0 for no limit
+    LineFilter(double max_rate, bool dedupe)
+        : rate_(max_rate), capacity_(std::max(1.0, max_rate)), dedupe_(dedupe), tokens_(capacity_),
+          refilled_(Clock::now()) {}
+
+    // Pass what is let through of `input`, and the summaries, to `out` (a
+    // callable taking a string_view), in order
+    template <typename Out>
+    void accept(std::string_view input, Out&& out);
+
+    // End of input: pass the last partial line and pending summaries
+    template <typename Out>
+    void finish(Out&& out);
+
+private:
+    const double rate_;
+    const double capacity_;
+    const bool dedupe_;
+
+    // Rate limit
+    double tokens_;
+    Clock::time_point refilled_;
+    uint64_t suppressed_ = 0;
+    bool in_line_        = false; // passing on (or dropping) a line
+    bool dropping_       = false; // ... and it is dropped
+    bool line_start_     = true;  // what went to `out` ends a line
+
+    // Dedupe
+    std::string line_;            // the current line, up to its '\n'
+    std::string previous_;
+    bool has_previous_ = false;
+    bool streaming_    = false;   // current line too long to hold: passed on as it comes
+    uint64_t repeats_  = 0;
+
+    bool admit();
+
+    template <typename Out>
+    void pass(std::string_view part, Out& out);
+    template <typename Out>
+    void dedupe(std::string_view part, Out& out);
+    template <typename Out>
+    void summarize(Out& out, uint64_t& count, const char* one, const char* many);
+    template <typename Out>
+    void summarize_repeats(Out& out) {
+        summarize(out, repeats_, "last line repeated %llu time\n", "last line repeated %llu times\n");
+    }
+    template <typename Out>
+    void summarize_suppressed(Out& out) {
+        summarize(out, suppressed_, "%llu line suppressed\n", "%llu lines suppressed\n");
+    }
+};
+
+// Implementation
+
+template <typename Out>
+void LineFilter::accept(std::string_view input, Out&& out) {
+    while (!input.empty()) {
+        size_t end = input.find('\n');
+        size_t len = end == std::string_view::npos ? input.size() : end + 1;
+        if (dedupe_) {
+            dedupe(input.substr(0, len), out);
+        } else {
+            pass(input.substr(0, len), out);
+        }
+        input.remove_prefix(len);
+    }
+}
+
+template <typename Out>
+void LineFilter::finish(Out&& out) {
+    if (!line_.empty()) { // a last line without '\n' is never a repeat
+        summarize_repeats(out);
+        pass(std::string_view(line_), out);
+        line_.clear();
+    }
+    summarize_repeats(out);
+    summarize_suppressed(out);
+}
+
+inline bool LineFilter::admit() {
+    if (rate_ <= 0) return true;
+    if (tokens_ < 1) {
+        // Refilled only when empty: one clock read per `capacity_` lines at most
+        auto now = Clock::now();
+        std::chrono::duration<double> elapsed = now - refilled_;
+        tokens_   = std::min(capacity_, tokens_ + elapsed.count() * rate_);
+        refilled_ = now;
+        if (tokens_ < 1) return false;
+    }
+    tokens_ -= 1;
+    return true;
+}
+
+// A line, or part of one, subject to the rate limit
+template <typename Out>
+void LineFilter::pass(std::string_view part, Out& out) {
+    if (!in_line_) {
+        dropping_ = !admit();
+        in_line_  = true;
+        if (dropping_) {
+            ++suppressed_;
+        } else {
+            summarize_suppressed(out);
+        }
+    }
+    if (!dropping_) {
+        out(part);
+        line_start_ = part.back() == '\n';
+    }
+    if (part.back() == '\n') in_line_ = false;
+}
+
+// A line, or part of one, checked against the previous line first
+template <typename Out>
+void LineFilter::dedupe(std::string_view part, Out& out) {
+    bool complete = part.back() == '\n';
+    if (streaming_) {
+        pass(part, out);
+        streaming_ = !complete;
+        return;
+    }
+
+    line_ += part;
+    if (!complete) {
+        if (line_.size() <= MAX_LINE) return;
+        summarize_repeats(out);
+        pass(std::string_view(line_), out);
+        line_.clear();
+        has_previous_ = false;
+        streaming_    = true;
+        return;
+    }
+
+    if (has_previous_ && line_ == previous_) {
+        ++repeats_;
+    } else {
+        summarize_repeats(out);
+        pass(std::string_view(line_), out);
+        previous_.swap(line_);
+        has_previous_ = true;
+    }
+    line_.clear();
+}
+
+template <typename Out>
+void LineFilter::summarize(Out& out, uint64_t& count, const char* one, const char* many) {
+    if (!count) return;
+    char text[64];
+    int n = std::snprintf(text, sizeof(text), count == 1 ? one : many, static_cast<unsigned long long>(count));
+    if (!line_start_) out(std::string_view("\n"));
+    out(std::string_view(text, static_cast<size_t>(n)));
+    line_start_ = true;
+    count       = 0;
+}
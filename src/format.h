@@ -1,11 +1,14 @@
 // format.h - Format representation for text styling
 #pragma once
 
+#include <array>
 #include <cassert>
 #include <cstdint>
 #include <string>
+#include <string_view>
 
 #include "ansi.h"
+#include "palette.h"
 #include "syntax.h"
 
 // Format state using bitfields for compact representation
@@ -81,39 +84,47 @@ struct Format {
         dim              = (bits >> 8) & 1;
     }
 
-    // Convert to ANSI escape sequence
-    std::string to_ansi() const {
+    // Convert to ANSI escape sequence, colors as mapped by `palette`
+    std::string to_ansi(const Palette& palette = Palette::standard()) const {
         assert(valid && reset);
 
-        std::string result;
-        result.reserve(ansi::MAX_SEQ_LEN);
-        result = ansi::ESC_START;
-        result += std::to_string(ansi::RESET);
-
-        auto append_sgr = [&result](ansi::SGR code) {
-            result += ansi::SEP;
-            result += std::to_string(code);
-        };
+        std::string_view styles = style_prefix(style_bits());
+        std::string_view fg     = palette.fg(fg_color, fg_bright);
+        std::string_view bg     = palette.bg(bg_color, bg_bright);
 
-        if (bold)             append_sgr(ansi::BOLD);
-        if (dim)              append_sgr(ansi::DIM);
-        if (italic)           append_sgr(ansi::ITALIC);
-        if (underline)        append_sgr(ansi::UNDERLINE);
-        if (blink)            append_sgr(ansi::BLINK);
-        if (reversed)         append_sgr(ansi::REVERSED);
-        if (strikethrough)    append_sgr(ansi::STRIKETHROUGH);
-        if (double_underline) append_sgr(ansi::DOUBLE_UNDERLINE);
-        if (overline)         append_sgr(ansi::OVERLINE);
-
-        // FG color: 30-37 or 90-97 (bright)
+        std::string result;
+        result.reserve(styles.size() + fg.size() + bg.size() + 3);
+        result = styles;
         result += ansi::SEP;
-        result += std::to_string(ansi::FG_BASE + fg_color + (fg_bright ? ansi::BRIGHT_OFFSET : 0));
-
-        // BG color: 40-47 or 100-107 (bright)
+        result += fg;
         result += ansi::SEP;
-        result += std::to_string(ansi::BG_BASE + bg_color + (bg_bright ? ansi::BRIGHT_OFFSET : 0));
-
+        result += bg;
         result += ansi::ESC_END;
         return result;
     }
+
+private:
+    // "\e[0;1;3" and so on for every combination of style_bits(), built once
+    static std::string_view style_prefix(uint16_t bits) {
+        static const std::array<std::string, 512> table = [] {
+            // Bits of style_bits() in the order the codes are written
+            static constexpr struct { int bit; ansi::SGR code; } ORDER[] = {
+                {2, ansi::BOLD},          {8, ansi::DIM},              {3, ansi::ITALIC},
+                {4, ansi::UNDERLINE},     {1, ansi::BLINK},            {0, ansi::REVERSED},
+                {7, ansi::STRIKETHROUGH}, {6, ansi::DOUBLE_UNDERLINE}, {5, ansi::OVERLINE},
+            };
+            std::array<std::string, 512> t;
+            for (size_t bits = 0; bits < t.size(); ++bits) {
+                t[bits] = ansi::ESC_START;
+                t[bits] += std::to_string(ansi::RESET);
+                for (auto [bit, code] : ORDER) {
+                    if (!(bits >> bit & 1)) continue;
+                    t[bits] += ansi::SEP;
+                    t[bits] += std::to_string(code);
+                }
+            }
+            return t;
+        }();
+        return table[bits];
+    }
 };
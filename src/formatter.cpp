@@ -2,15 +2,44 @@
 // Homepage: @HOMEPAGE
 // Version: @SVERSION
 
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <getopt.h>
 #include <memory>
+#include <optional>
+#include <poll.h>
+#include <string_view>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
 
+#include "alphabet.h"
 #include "automaton.h"
+#include "catalog.h"
+#include "collapse.h"
+#include "compress.h"
+#include "cut.h"
+#include "fd_sink.h"
+#include "flood.h"
+#include "format.h"
+#include "grep.h"
+#include "highlight.h"
+#include "optimize.h"
+#include "palette.h"
+#include "perf.h"
+#include "profile.h"
+#include "progress.h"
+#include "signals.h"
+#include "syntax_set.h"
+#include "table.h"
 #include "tag_syntax.h"
 #include "texts.h"
+#include "width.h"
 
 // ============================================================================
 // Command-line interface
@@ -21,8 +50,34 @@ namespace {
 int f_strip       = 0;
 int f_escape      = 0;
 int f_no_sanitize = 0;
-const TagSyntax* f_syntax = &TagSyntax::CLASSIC;
-std::unique_ptr<TagSyntax> f_custom_syntax;
+int f_width       = 0;
+int f_optimize    = 0;
+int f_stats       = 0;
+int f_progress    = 0;
+int f_dedupe      = 0;
+int f_profile     = 0;
+SyntaxSet f_syntaxes; // empty = classic
+std::vector<std::unique_ptr<TagSyntax>> f_custom_syntaxes;
+FdSink::Flush f_flush = FdSink::Flush::AUTO;
+unsigned f_collapse_fps = 0; // 0 = --collapse-cr not given
+double f_max_rate = 0;       // lines per second, 0 = --max-rate not given
+KeywordHighlighter f_keywords;
+RegexHighlighter f_rules;
+RegexSet f_grep;
+size_t f_cut_columns = 0; // 0 = --cut not given
+std::string f_ellipsis;
+const char* f_table_separator = nullptr;
+std::optional<CompressSink::Format> f_compress;
+Palette f_palette;
+SpecifierAlphabet f_alphabet;
+// Files naming specifier characters, loaded once --alphabet is known
+std::vector<const char*> f_keyword_files;
+std::vector<const char*> f_rules_files;
+std::vector<const char*> f_palette_files;
+MessageCatalog f_catalog;
+const char* f_catalog_path = nullptr; // --emit-header given
+InputProfile f_replay;
+bool f_generate = false; // --generate-input given
 
 struct option long_options[] = {
     {"help",        no_argument,       nullptr,        'h'},
@@ -34,6 +89,26 @@ struct option long_options[] = {
     {"syntax",      required_argument, nullptr,        'x'},
     {"custom",      no_argument,       nullptr,        'c'},
     {"demo",        no_argument,       nullptr,        0  },
+    {"flush",       required_argument, nullptr,        0  },
+    {"collapse-cr", optional_argument, nullptr,        0  },
+    {"highlight-file", required_argument, nullptr,     0  },
+    {"rules",       required_argument, nullptr,        0  },
+    {"grep",        required_argument, nullptr,        0  },
+    {"width",       no_argument,       &f_width,       1  },
+    {"cut",         required_argument, nullptr,        0  },
+    {"ellipsis",    optional_argument, nullptr,        0  },
+    {"table",       required_argument, nullptr,        0  },
+    {"optimize-ansi", no_argument,     &f_optimize,    1  },
+    {"stats",       no_argument,       &f_stats,       1  },
+    {"progress",    no_argument,       &f_progress,    1  },
+    {"max-rate",    required_argument, nullptr,        0  },
+    {"dedupe",      no_argument,       &f_dedupe,      1  },
+    {"profile-input", no_argument,     &f_profile,     1  },
+    {"generate-input", required_argument, nullptr,     0  },
+    {"emit-header", required_argument, nullptr,        0  },
+    {"compress",    required_argument, nullptr,        0  },
+    {"palette",     required_argument, nullptr,        0  },
+    {"alphabet",    required_argument, nullptr,        0  },
     {nullptr,       0,                 nullptr,        0  },
 };
 
@@ -57,16 +132,32 @@ int handle_legend() {
     return EXIT_SUCCESS;
 }
 
-int handle_syntax_option(const char* optarg) {
-    f_syntax = TagSyntax::find(optarg);
-    if (!f_syntax) {
-        std::fprintf(stderr, "Unknown syntax: %s\n", optarg);
-        std::fprintf(stderr, "Available: classic, bracket, xml (or use -c for custom)\n");
+int add_syntax(const TagSyntax& syntax) {
+    if (!f_syntaxes.add(syntax)) {
+        std::fprintf(stderr, "Too many syntaxes (at most %zu)\n", SyntaxSet::MAX_SYNTAXES);
         return EXIT_FAILURE;
     }
     return -1; // continue processing
 }
 
+// Comma-separated list of style names, all recognised at once
+int handle_syntax_option(const char* optarg) {
+    std::string_view names(optarg);
+    while (true) {
+        size_t comma          = std::min(names.find(','), names.size());
+        std::string_view name = names.substr(0, comma);
+        const TagSyntax* syntax = TagSyntax::find(name);
+        if (!syntax) {
+            std::fprintf(stderr, "Unknown syntax: %.*s\n", static_cast<int>(name.size()), name.data());
+            std::fprintf(stderr, "Available: classic, bracket, xml (or use -c for custom)\n");
+            return EXIT_FAILURE;
+        }
+        if (int result = add_syntax(*syntax); result != -1) return result;
+        if (comma == names.size()) return -1; // continue processing
+        names.remove_prefix(comma + 1);
+    }
+}
+
 int handle_custom_syntax(int argc, char* argv[]) {
     if (optind + 2 >= argc) {
         std::fprintf(stderr, "Custom syntax requires 3 arguments: OPEN SEP CLOSE\n");
@@ -74,8 +165,8 @@ int handle_custom_syntax(int argc, char* argv[]) {
         return EXIT_FAILURE;
     }
     
-    f_custom_syntax = TagSyntax::from_args(argv[optind], argv[optind + 1], argv[optind + 2]);
-    if (!f_custom_syntax) {
+    auto syntax = TagSyntax::from_args(argv[optind], argv[optind + 1], argv[optind + 2]);
+    if (!syntax) {
         std::fprintf(stderr, "Invalid custom syntax: '%s' '%s' '%s'\n",
                      argv[optind], argv[optind + 1], argv[optind + 2]);
         std::fprintf(stderr, "All three arguments must be non-empty strings\n");
@@ -83,29 +174,330 @@ int handle_custom_syntax(int argc, char* argv[]) {
     }
     
     optind += 3;
-    f_syntax = f_custom_syntax.get();
+    f_custom_syntaxes.push_back(std::move(syntax));
+    return add_syntax(*f_custom_syntaxes.back());
+}
+
+int handle_flush_option(const char* optarg) {
+    static constexpr struct { const char* name; FdSink::Flush policy; } POLICIES[] = {
+        {"auto", FdSink::Flush::AUTO},
+        {"line", FdSink::Flush::LINE},
+        {"full", FdSink::Flush::FULL},
+        {"none", FdSink::Flush::NONE},
+        {"sync", FdSink::Flush::SYNC},
+    };
+    for (const auto& p : POLICIES) {
+        if (std::strcmp(optarg, p.name) == 0) {
+            f_flush = p.policy;
+            return -1; // continue processing
+        }
+    }
+    std::fprintf(stderr, "Unknown flush policy: %s\n", optarg);
+    std::fprintf(stderr, "Available: auto, line, full, none, sync\n");
+    return EXIT_FAILURE;
+}
+
+int handle_collapse_option(const char* optarg) {
+    f_collapse_fps = 30;
+    if (optarg) {
+        char* end;
+        long fps = std::strtol(optarg, &end, 10);
+        if (*end || fps < 1 || fps > 1000) {
+            std::fprintf(stderr, "Invalid frame rate: %s (expected 1-1000)\n", optarg);
+            return EXIT_FAILURE;
+        }
+        f_collapse_fps = static_cast<unsigned>(fps);
+    }
+    return -1; // continue processing
+}
+
+// Load the file of a --highlight-file, --rules, --palette, ... option into
+// `target`; `args` follow the file and error in the call to its load()
+template <typename Target, typename... Args>
+int load_file_option(Target& target, const char* what, const char* path, const Args&... args) {
+    FILE* file = std::fopen(path, "r");
+    if (!file) {
+        std::fprintf(stderr, "Cannot open %s file: %s: %s\n", what, path, std::strerror(errno));
+        return EXIT_FAILURE;
+    }
+    std::string error;
+    bool ok = target.load(file, error, args...);
+    std::fclose(file);
+    if (!ok) {
+        std::fprintf(stderr, "Invalid %s file: %s: %s\n", what, path, error.c_str());
+        return EXIT_FAILURE;
+    }
+    return -1; // continue processing
+}
+
+// The --highlight-file, --rules and --palette files, in the alphabet of
+// --alphabet wherever it was given; returns -1 to continue or an exit status
+int load_alphabet_files() {
+    for (const char* path : f_keyword_files) {
+        if (int result = load_file_option(f_keywords, "highlight", path, f_alphabet); result != -1) return result;
+    }
+    for (const char* path : f_rules_files) {
+        if (int result = load_file_option(f_rules, "rules", path, f_alphabet); result != -1) return result;
+    }
+    for (const char* path : f_palette_files) {
+        if (int result = load_file_option(f_palette, "palette", path, f_alphabet); result != -1) return result;
+    }
     return -1; // continue processing
 }
 
-void process_arguments(int argc, char* argv[]) {
-    const char* separator = "";
-    while (optind < argc) {
-        std::printf("%s", separator);
-        FormatterAutomaton automaton(f_strip, f_escape, !f_no_sanitize, *f_syntax);
-        for (const char* p = argv[optind]; *p; ++p) {
-            automaton.accept(*p);
+int handle_grep_option(const char* optarg) {
+    std::string error;
+    if (!f_grep.add(optarg, error)) {
+        std::fprintf(stderr, "Invalid grep pattern: %s: %s\n", optarg, error.c_str());
+        return EXIT_FAILURE;
+    }
+    return -1; // continue processing
+}
+
+// LINES or LINES/s
+int handle_max_rate_option(const char* optarg) {
+    char* end;
+    double rate = std::strtod(optarg, &end);
+    if ((*end && std::strcmp(end, "/s") != 0) || !(rate > 0)) {
+        std::fprintf(stderr, "Invalid rate: %s (expected a positive number of lines per second)\n", optarg);
+        return EXIT_FAILURE;
+    }
+    f_max_rate = rate;
+    return -1; // continue processing
+}
+
+int handle_cut_option(const char* optarg) {
+    char* end;
+    long columns = std::strtol(optarg, &end, 10);
+    if (*end || columns < 1) {
+        std::fprintf(stderr, "Invalid column count: %s (expected a positive number)\n", optarg);
+        return EXIT_FAILURE;
+    }
+    f_cut_columns = static_cast<size_t>(columns);
+    return -1; // continue processing
+}
+
+int handle_compress_option(const char* optarg) {
+    static constexpr struct { const char* name; CompressSink::Format format; } FORMATS[] = {
+        {"gzip", CompressSink::Format::GZIP},
+        {"zstd", CompressSink::Format::ZSTD},
+    };
+    for (const auto& f : FORMATS) {
+        if (std::strcmp(optarg, f.name) != 0) continue;
+        if (!CompressSink::supported(f.format)) {
+            std::fprintf(stderr, "Compression not available in this build: %s\n", optarg);
+            return EXIT_FAILURE;
+        }
+        f_compress = f.format;
+        return -1; // continue processing
+    }
+    std::fprintf(stderr, "Unknown compression: %s\n", optarg);
+    std::fprintf(stderr, "Available: gzip, zstd\n");
+    return EXIT_FAILURE;
+}
+
+// Long-only options; returns -1 to continue or an exit status
+int handle_long_option(const char* name, const char* optarg) {
+    if (std::strcmp(name, "flush") == 0)          return handle_flush_option(optarg);
+    if (std::strcmp(name, "collapse-cr") == 0)    return handle_collapse_option(optarg);
+    if (std::strcmp(name, "grep") == 0)           return handle_grep_option(optarg);
+    if (std::strcmp(name, "cut") == 0)            return handle_cut_option(optarg);
+    if (std::strcmp(name, "max-rate") == 0)       return handle_max_rate_option(optarg);
+    if (std::strcmp(name, "compress") == 0)       return handle_compress_option(optarg);
+    if (std::strcmp(name, "alphabet") == 0)       return load_file_option(f_alphabet, "alphabet", optarg);
+    if (std::strcmp(name, "generate-input") == 0) {
+        f_generate = true;
+        return load_file_option(f_replay, "profile", optarg);
+    }
+    if (std::strcmp(name, "emit-header") == 0) {
+        f_catalog_path = optarg;
+        return load_file_option(f_catalog, "catalog", optarg);
+    }
+    if (std::strcmp(name, "highlight-file") == 0) {
+        f_keyword_files.push_back(optarg); // loaded by load_alphabet_files()
+        return -1;
+    }
+    if (std::strcmp(name, "rules") == 0) {
+        f_rules_files.push_back(optarg); // loaded by load_alphabet_files()
+        return -1;
+    }
+    if (std::strcmp(name, "palette") == 0) {
+        f_palette_files.push_back(optarg); // loaded by load_alphabet_files()
+        return -1;
+    }
+    if (std::strcmp(name, "table") == 0) {
+        if (!*optarg) {
+            std::fprintf(stderr, "Table separator must not be empty\n");
+            return EXIT_FAILURE;
+        }
+        f_table_separator = optarg;
+        return -1; // continue processing
+    }
+    if (std::strcmp(name, "ellipsis") == 0) {
+        f_ellipsis = optarg ? optarg : "…";
+        return -1; // continue processing
+    }
+    return EXIT_FAILURE;
+}
+
+// --emit-header: the catalog as a C header on stdout, rendered with the
+// syntax and escape options given
+int emit_catalog_header() {
+    std::string header = f_catalog.emit_header(MessageCatalog::guard_for(f_catalog_path), f_syntaxes,
+                                               f_escape, !f_no_sanitize, f_palette, f_alphabet);
+    FdSink out(STDOUT_FILENO);
+    out.write(header);
+    out.flush();
+    return out.failed() ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+// --profile-input: statistics of stdin, parsed with the syntax and escape
+// options given, as a profile on stdout; the rendered text is discarded
+int profile_input() {
+    InputProfile profile;
+    DiscardSink discard;
+    FormatterAutomaton automaton(f_strip, f_escape, !f_no_sanitize, f_syntaxes, discard, f_palette,
+                                 f_alphabet);
+    automaton.set_observer(&profile);
+    char buffer[FdSink::DEFAULT_CAPACITY];
+    while (true) {
+        ssize_t n = read(STDIN_FILENO, buffer, sizeof(buffer));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        std::string_view input(buffer, static_cast<size_t>(n));
+        profile.record(input);
+        automaton.accept(input);
+    }
+    automaton.finish();
+    profile.finish();
+
+    FdSink out(STDOUT_FILENO);
+    out.write(profile.to_text());
+    out.flush();
+    return out.failed() ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+// --generate-input: as many bytes as the profile was taken from, synthesized
+// in pieces so the whole input is never held in memory, in the first syntax
+// given (as the profile does not record one)
+int generate_input() {
+    static constexpr size_t PIECE = 16 * 1024 * 1024;
+    FdSink out(STDOUT_FILENO);
+    uint32_t seed = 42;
+    for (uint64_t written = 0; written < f_replay.bytes() && !out.failed();) {
+        std::string piece = f_replay.generate(std::min<uint64_t>(PIECE, f_replay.bytes() - written), seed++,
+                                             f_syntaxes[0]);
+        out.write(piece);
+        written += piece.size();
+    }
+    out.flush();
+    return out.failed() ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+// Attach the optional processing stages selected on the command line
+void configure(FormatterAutomaton& automaton) {
+    if (f_keywords.size()) automaton.add_highlighter(f_keywords);
+    if (f_rules.size())    automaton.add_highlighter(f_rules);
+}
+
+// Both return the number of input bytes processed, and end early on SIGINT
+// or SIGTERM
+uint64_t process_arguments(int argc, char* argv[], Sink& out) {
+    uint64_t bytes = 0;
+    std::string_view separator;
+    while (optind < argc && !signals::pending()) {
+        out.write(separator);
+        FormatterAutomaton automaton(f_strip, f_escape, !f_no_sanitize, f_syntaxes, out, f_palette,
+                                     f_alphabet);
+        configure(automaton);
+        std::string_view text(argv[optind]);
+        automaton.accept(text);
+        bytes += text.size();
+        if (f_width) {
+            automaton.finish();
+            out.put('\n'); // --width reports each argument on its own line
+        } else {
+            separator = " ";
         }
-        separator = " ";
         optind++;
     }
+    return bytes;
 }
 
-void process_stream(FILE* stream) {
-    FormatterAutomaton automaton(f_strip, f_escape, !f_no_sanitize, *f_syntax);
+// In-memory input (--demo)
+uint64_t process_stream(FILE* stream, Sink& out) {
+    uint64_t bytes = 0;
+    FormatterAutomaton automaton(f_strip, f_escape, !f_no_sanitize, f_syntaxes, out, f_palette,
+                                 f_alphabet);
+    configure(automaton);
     int c;
-    while ((c = std::getc(stream)) != EOF) {
+    while (!signals::pending() && (c = std::getc(stream)) != EOF) {
         automaton.accept(c);
+        ++bytes;
+    }
+    return bytes;
+}
+
+// Whether read(2) on `fd` would return without waiting
+bool input_ready(int fd) {
+    pollfd pfd{fd, POLLIN, 0};
+    return ::poll(&pfd, 1, 0) != 0; // errors included: read() reports them
+}
+
+// Input in chunks of whatever read(2) returns. With --flush=sync each chunk's
+// output goes out as one batch, so input that arrives together is painted
+// together and interactive input still shows up as soon as it is typed.
+// `progress` (--progress) is told about each chunk. With --max-rate or
+// --dedupe, lines are filtered before they reach the automaton. SIGINT and
+// SIGTERM end the input early. `collapse` (--collapse-cr) is told when input
+// pauses.
+uint64_t process_fd(int fd, Sink& out, FdSink& batches, ProgressMeter* progress, CollapseSink* collapse) {
+    uint64_t bytes = 0;
+    FormatterAutomaton automaton(f_strip, f_escape, !f_no_sanitize, f_syntaxes, out, f_palette,
+                                 f_alphabet);
+    configure(automaton);
+    std::optional<LineFilter> filter;
+    if (f_max_rate || f_dedupe) filter.emplace(f_max_rate, f_dedupe);
+    auto render = [&automaton](std::string_view text) { automaton.accept(text); };
+    char buffer[FdSink::DEFAULT_CAPACITY];
+    while (true) {
+        if (signals::pending()) break; // finish as at the end of input
+        if (collapse && !input_ready(fd)) collapse->idle();
+        if (!signals::wait_readable(fd)) continue; // interrupted
+        ssize_t n = read(fd, buffer, sizeof(buffer));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        if (progress) progress->input_ready();
+        std::string_view input(buffer, static_cast<size_t>(n));
+        if (filter) {
+            filter->accept(input, render);
+        } else {
+            automaton.accept(input);
+        }
+        bytes += static_cast<uint64_t>(n);
+        if (batches.policy() == FdSink::Flush::SYNC) batches.flush();
+        if (progress) progress->update(bytes, automaton.tags());
     }
+    if (filter) filter->finish(render);
+    if (progress) progress->finish(bytes, automaton.tags());
+    return bytes;
+}
+
+// Bytes left to read from `fd` if it is a regular file, 0 if unknown
+uint64_t remaining_input(int fd) {
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) return 0;
+    off_t offset = lseek(fd, 0, SEEK_CUR);
+    return st.st_size > offset && offset >= 0 ? static_cast<uint64_t>(st.st_size - offset) : 0;
+}
+
+// --stats: sizes, time and hardware counters of the run, on stderr
+void print_stats(uint64_t input, uint64_t output, double seconds, const PerfCounters& counters) {
+    double mbps = seconds > 0 ? static_cast<double>(input) / seconds / (1024 * 1024) : 0;
+    std::fprintf(stderr, "stats: %-14s %14llu bytes\n", "input", static_cast<unsigned long long>(input));
+    std::fprintf(stderr, "stats: %-14s %14llu bytes\n", "output", static_cast<unsigned long long>(output));
+    std::fprintf(stderr, "stats: %-14s %14.3f ms  (%.1f MB/s)\n", "time", seconds * 1000, mbps);
+    counters.print(stderr, "stats: ", input);
 }
 
 } // namespace
@@ -124,11 +516,14 @@ int main(int argc, char* argv[]) {
         
         switch (opt) {
         case 0:
+            if (long_options[opt_idx].flag) break; // set by getopt itself
             if (std::strcmp(long_options[opt_idx].name, "demo") == 0) {
                 istream = fmemopen(const_cast<char*>(texts::DEMO), std::strlen(texts::DEMO), "r");
                 break;
             }
-            [[fallthrough]];
+            result = handle_long_option(long_options[opt_idx].name, optarg);
+            if (result != -1) return result;
+            break;
             
         case '?':
             print_usage(argv[0], stderr);
@@ -154,11 +549,81 @@ int main(int argc, char* argv[]) {
         }
     }
 
+    if (int result = load_alphabet_files(); result != -1) return result;
+    if (f_syntaxes.empty()) f_syntaxes.add(TagSyntax::CLASSIC);
+    if (f_catalog_path) return emit_catalog_header();
+    if (f_profile) return profile_input();
+    if (f_generate) return generate_input();
+    if (f_width) f_strip = 1; // measure the text, not the escapes
+
+    FdSink out(STDOUT_FILENO, f_flush);
+    signals::install();
+
+    // Optional stages between the automaton and stdout
+    Sink* sink = &out;
+    std::optional<CountingSink> counting;
+    std::optional<CompressSink> compress;
+    if (f_stats) {
+        sink = &counting.emplace(*sink);
+    }
+    if (f_compress) {
+        sink = &compress.emplace(*sink, *f_compress);
+    }
+    std::optional<OptimizeSink> optimize;
+    std::optional<CollapseSink> collapse;
+    std::optional<CutSink> cut;
+    std::optional<TableSink> table;
+    std::optional<GrepSink> grep;
+    if (f_optimize && !f_strip) {
+        sink = &optimize.emplace(*sink);
+    }
+    if (f_collapse_fps) {
+        sink = &collapse.emplace(*sink, isatty(STDOUT_FILENO), f_collapse_fps);
+    }
+    if (f_cut_columns) {
+        sink = &cut.emplace(*sink, f_cut_columns, f_ellipsis);
+    }
+    std::optional<LineWidthSink> width;
+    if (f_table_separator) {
+        sink = &table.emplace(*sink, f_table_separator);
+    }
+    if (f_grep.size()) {
+        sink = &grep.emplace(*sink, f_grep);
+    }
+    if (f_width) {
+        sink = &width.emplace(*sink);
+    }
+
+    std::optional<PerfCounters> counters;
+    if (f_stats) counters.emplace().start();
+    auto begin = std::chrono::steady_clock::now();
+
+    uint64_t input;
     if (optind < argc) {
-        process_arguments(argc, argv);
+        input = process_arguments(argc, argv, *sink);
+    } else if (istream == stdin) {
+        std::optional<ProgressMeter> progress;
+        if (f_progress) progress.emplace(stderr, isatty(STDERR_FILENO), remaining_input(STDIN_FILENO));
+        input = process_fd(STDIN_FILENO, *sink, out, progress ? &*progress : nullptr,
+                           collapse ? &*collapse : nullptr);
     } else {
-        process_stream(istream);
+        input = process_stream(istream, *sink);
+    }
+
+    sink->flush();
+    if (compress) compress->finish();
+    out.flush();
+
+    if (f_stats) {
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+        counters->stop();
+        print_stats(input, counting->bytes(), elapsed.count(), *counters);
     }
+    signals::raise_pending();
 
+    if (compress && compress->failed()) {
+        std::fprintf(stderr, "Compression failed\n");
+        return EXIT_FAILURE;
+    }
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,129 @@
+// grep.h - Keep only lines whose visible text matches a pattern
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#include "ansi.h"
+#include "regex.h"
+#include "sink.h"
+
+// Sink decorator that filters rendered output by line. Patterns are matched
+// against the visible text of a line (escape sequences removed, so a match
+// may span tags), but kept lines are written as rendered.
+//
+// SGR sequences of dropped lines are held back and written before the next
+// kept line, so it shows in the format that was active at that point.
+class GrepSink : public Sink {
+public:
+    // Lines longer than this are decided on their first MAX_LINE bytes
+    static constexpr size_t MAX_LINE = 64 * 1024;
+
+    GrepSink(Sink& out, const RegexSet& patterns) : out_(out), matcher_(patterns) {}
+
+    void write(std::string_view text) override {
+        while (!text.empty()) {
+            size_t newline = text.find('\n');
+            size_t len     = newline == std::string_view::npos ? text.size() : newline + 1;
+
+            if (passthrough_) {
+                out_.write(text.substr(0, len));
+            } else {
+                line_ += text.substr(0, len);
+            }
+
+            if (newline != std::string_view::npos) {
+                if (dropping_) {
+                    drop();
+                } else if (!passthrough_) {
+                    end_line(true);
+                }
+                passthrough_ = dropping_ = false;
+            } else if (!passthrough_ && line_.size() >= MAX_LINE) {
+                if (dropping_) {
+                    drop();
+                } else {
+                    end_line(false);
+                }
+            }
+            text.remove_prefix(len);
+        }
+    }
+
+    void put(char c) override { write(std::string_view(&c, 1)); }
+
+    void flush() override {
+        if (dropping_) {
+            drop();
+        } else if (!line_.empty()) {
+            end_line(true);
+        }
+        out_.write(pending_);
+        pending_.clear();
+        out_.flush();
+    }
+
+private:
+    Sink& out_;
+    RegexSet::Matcher matcher_; // its DFA cache is per sink
+
+    std::string line_;         // rendered bytes of the current line
+    std::string visible_;      // scratch: line_ without escape sequences
+    std::string pending_;      // SGRs of dropped lines, not yet written
+    bool passthrough_ = false; // rest of an overlong matching line
+    bool dropping_    = false; // rest of an overlong line that did not match
+
+    // Decide line_; `complete` is false for the head of an overlong line
+    void end_line(bool complete) {
+        visible_.clear();
+        std::string_view line(line_);
+        for (size_t i = 0; i < line.size(); ++i) {
+            size_t len = ansi::csi_length(line.substr(i));
+            if (len) {
+                i += len - 1;
+            } else {
+                visible_ += line[i];
+            }
+        }
+        if (!visible_.empty() && visible_.back() == '\n') visible_.pop_back();
+
+        // A trailing line with no text is just the final reset
+        if (visible_.empty() && !line.empty() && line.back() != '\n') {
+            keep();
+            return;
+        }
+
+        size_t eol = complete ? visible_.size() : RegexSet::NPOS;
+        if (matcher_.contains(visible_, true, eol)) {
+            keep();
+            passthrough_ = !complete;
+        } else {
+            drop();
+            dropping_ = !complete;
+        }
+    }
+
+    void keep() {
+        out_.write(pending_);
+        out_.write(line_);
+        pending_.clear();
+        line_.clear();
+    }
+
+    // Hold back only the SGRs; those before a reset SGR no longer matter
+    void drop() {
+        std::string_view line(line_);
+        for (size_t i = 0; i < line.size(); ++i) {
+            size_t len = ansi::csi_length(line.substr(i));
+            if (!len) continue;
+            std::string_view seq = line.substr(i, len);
+            if (seq.back() == ansi::ESC_END) {
+                if (ansi::sgr_resets(seq)) pending_.clear();
+                pending_ += seq;
+            }
+            i += len - 1;
+        }
+        line_.clear();
+    }
+};
@@ -0,0 +1,298 @@
+// highlight.h - Automatic highlighting of visible text (keywords, patterns)
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "config_file.h"
+#include "format.h"
+#include "regex.h"
+#include "specifier.h"
+
+// A span of visible text to wrap in a format, as if it had been tagged
+struct Match {
+    size_t begin;
+    size_t end;
+    Format format; // format mask, applied like a tag's specifier
+};
+
+// Finds spans to highlight in a segment of visible text (text between two
+// tags, never crossing a newline). `line_start`/`line_end` tell whether the
+// segment begins/ends a line (a trailing '\n' is part of the segment).
+// Matches are appended in ascending, non-overlapping order.
+//
+// The automaton hands over a segment's text with scan() as the tag scan
+// emits it, so a highlighter can match in that same pass, then calls find()
+// with the whole segment. scan() is optional: find() matches what was not
+// scanned itself.
+//
+// Neither modifies the highlighter: working memory lives in a Scratch from
+// make_scratch(), owned by the caller, so a highlighter can be shared by
+// several automatons and threads.
+class Highlighter {
+public:
+    struct Scratch {
+        virtual ~Scratch() = default;
+    };
+
+    virtual ~Highlighter() = default;
+    virtual std::unique_ptr<Scratch> make_scratch() const = 0;
+    virtual void scan(std::string_view, Scratch*) const {}
+    virtual void find(std::string_view text, bool line_start, bool line_end, Scratch* scratch,
+                      std::vector<Match>& out) const = 0;
+};
+
+// Read "PATTERN SPECIFIER" lines (the specifier is the last word, read in
+// `alphabet`; comments as in read_config_lines()) and pass them to
+// `add(pattern, format, error)`. Returns false and fills `error` on the
+// first invalid line.
+template <typename AddFn>
+bool load_rules(FILE* file, std::string& error, const SpecifierAlphabet& alphabet, AddFn&& add);
+
+// Literal keywords matched with an Aho–Corasick automaton: one pass over the
+// text regardless of the number of keywords. Overlaps resolve leftmost-longest.
+class KeywordHighlighter : public Highlighter {
+public:
+    // Later duplicates override earlier ones. Call build() before find().
+    void add(std::string_view keyword, const Format& format) {
+        if (keyword.empty()) return;
+        keywords_.emplace_back(keyword);
+        formats_.push_back(format);
+    }
+
+    size_t size() const { return keywords_.size(); }
+
+    // Compile the keywords into a DFA; find() only sees keywords added before
+    void build();
+
+    std::unique_ptr<Scratch> make_scratch() const override { return std::make_unique<Found>(); }
+
+    // Step the DFA over the next part of the segment
+    void scan(std::string_view text, Scratch* scratch) const override;
+
+    void find(std::string_view text, bool line_start, bool line_end, Scratch* scratch,
+              std::vector<Match>& out) const override;
+
+    // Load "KEYWORD SPECIFIER" lines, see load_rules(), and build()
+    bool load(FILE* file, std::string& error, const SpecifierAlphabet& alphabet = SpecifierAlphabet::standard()) {
+        auto add_keyword = [this](std::string_view keyword, const Format& format, std::string&) {
+            add(keyword, format);
+            return true;
+        };
+        bool ok = load_rules(file, error, alphabet, add_keyword);
+        build();
+        return ok;
+    }
+
+private:
+    static constexpr int32_t ROOT = 0;
+
+    // Keywords found in the text scanned so far, by start offset and
+    // keyword, its length and the DFA state after it
+    struct Found : Scratch {
+        std::vector<std::pair<size_t, int32_t>> keywords;
+        size_t scanned = 0;
+        int32_t state  = ROOT;
+    };
+
+    std::vector<std::string> keywords_;
+    std::vector<Format> formats_;
+    size_t built_ = 0; // keywords_[0, built_) are in the DFA
+
+    // Bytes that occur in no keyword share class 0
+    std::array<uint16_t, 256> byte_class_{};
+    size_t num_classes_ = 1;
+
+    // Per state: DFA row of num_classes_ entries, keyword ending here (or -1),
+    // and the nearest proper suffix state that ends a keyword (or -1)
+    std::vector<int32_t> next_;
+    std::vector<int32_t> keyword_at_;
+    std::vector<int32_t> dict_link_;
+
+    int32_t add_state() {
+        next_.resize(next_.size() + num_classes_, -1);
+        keyword_at_.push_back(-1);
+        dict_link_.push_back(-1);
+        return static_cast<int32_t>(keyword_at_.size() - 1);
+    }
+
+    int32_t& edge(int32_t state, uint8_t byte) {
+        return next_[static_cast<size_t>(state) * num_classes_ + byte_class_[byte]];
+    }
+    int32_t edge(int32_t state, uint8_t byte) const {
+        return next_[static_cast<size_t>(state) * num_classes_ + byte_class_[byte]];
+    }
+};
+
+// Regular expressions compiled into one lazily built DFA (see RegexSet).
+// Overlaps resolve leftmost-longest, then by rule order.
+class RegexHighlighter : public Highlighter {
+public:
+    bool add(std::string_view pattern, const Format& format, std::string& error) {
+        if (!patterns_.add(pattern, error)) return false;
+        formats_.push_back(format);
+        return true;
+    }
+
+    size_t size() const { return formats_.size(); }
+
+    // The DFA is built lazily per scratch; add no rules once one exists
+    std::unique_ptr<Scratch> make_scratch() const override { return std::make_unique<Matcher>(patterns_); }
+
+    void find(std::string_view text, bool line_start, bool line_end, Scratch* scratch,
+              std::vector<Match>& out) const override {
+        RegexSet::Matcher& matcher = static_cast<Matcher*>(scratch)->matcher;
+        size_t eol = RegexSet::NPOS;
+        if (!text.empty() && text.back() == '\n') {
+            eol = text.size() - 1;
+        } else if (line_end) {
+            eol = text.size();
+        }
+
+        size_t begin, end = 0;
+        int rule;
+        while (matcher.search(text, end, line_start, eol, begin, end, rule)) {
+            out.push_back({begin, end, formats_[rule]});
+        }
+    }
+
+    // Load "REGEX SPECIFIER" lines, see load_rules()
+    bool load(FILE* file, std::string& error, const SpecifierAlphabet& alphabet = SpecifierAlphabet::standard()) {
+        auto add_rule = [this](std::string_view pattern, const Format& format, std::string& why) {
+            return add(pattern, format, why);
+        };
+        return load_rules(file, error, alphabet, add_rule);
+    }
+
+private:
+    struct Matcher : Scratch {
+        explicit Matcher(const RegexSet& patterns) : matcher(patterns) {}
+        RegexSet::Matcher matcher;
+    };
+
+    RegexSet patterns_;
+    std::vector<Format> formats_;
+};
+
+// Implementation
+
+template <typename AddFn>
+bool load_rules(FILE* file, std::string& error, const SpecifierAlphabet& alphabet, AddFn&& add) {
+    return read_config_lines(file, error, [&](std::string_view line, std::string& why) {
+        std::string_view entry = line.substr(0, line.find_last_not_of(" \t") + 1);
+        auto split   = entry.find_last_of(" \t");
+        auto key_end = split == std::string_view::npos ? split : entry.find_last_not_of(" \t", split);
+        auto format  = split == std::string_view::npos ? std::nullopt
+                                                       : SpecifierParser::parse(entry.substr(split + 1), alphabet);
+        if (key_end == std::string_view::npos || !format) {
+            why = "expected 'PATTERN SPECIFIER', got '" + std::string(line) + "'";
+            return false;
+        }
+        return add(entry.substr(0, key_end + 1), *format, why);
+    });
+}
+
+inline void KeywordHighlighter::build() {
+    byte_class_.fill(0);
+    num_classes_ = 1;
+    for (const auto& keyword : keywords_) {
+        for (unsigned char c : keyword) {
+            if (!byte_class_[c]) byte_class_[c] = static_cast<uint16_t>(num_classes_++);
+        }
+    }
+
+    next_.clear();
+    keyword_at_.clear();
+    dict_link_.clear();
+    add_state();
+
+    // Trie
+    for (size_t k = 0; k < keywords_.size(); ++k) {
+        int32_t state = ROOT;
+        for (unsigned char c : keywords_[k]) {
+            if (edge(state, c) < 0) {
+                int32_t created = add_state();
+                edge(state, c)  = created;
+            }
+            state = edge(state, c);
+        }
+        keyword_at_[state] = static_cast<int32_t>(k);
+    }
+
+    // Failure links (BFS), folded into a complete transition table
+    std::vector<int32_t> fail(keyword_at_.size(), ROOT);
+    std::vector<int32_t> queue;
+    for (size_t cls = 0; cls < num_classes_; ++cls) {
+        int32_t& target = next_[cls];
+        if (target < 0) {
+            target = ROOT;
+        } else {
+            queue.push_back(target);
+        }
+    }
+    for (size_t head = 0; head < queue.size(); ++head) {
+        int32_t state  = queue[head];
+        int32_t suffix = fail[state];
+        dict_link_[state] = keyword_at_[suffix] >= 0 ? suffix : dict_link_[suffix];
+
+        for (size_t cls = 0; cls < num_classes_; ++cls) {
+            int32_t& target = next_[static_cast<size_t>(state) * num_classes_ + cls];
+            int32_t via_fail = next_[static_cast<size_t>(suffix) * num_classes_ + cls];
+            if (target < 0) {
+                target = via_fail;
+            } else {
+                fail[target] = via_fail;
+                queue.push_back(target);
+            }
+        }
+    }
+
+    built_ = keywords_.size();
+}
+
+inline void KeywordHighlighter::scan(std::string_view text, Scratch* scratch) const {
+    if (built_ == 0) return;
+
+    auto& found   = *static_cast<Found*>(scratch);
+    int32_t state = found.state;
+    for (size_t i = 0; i < text.size(); ++i) {
+        state = edge(state, static_cast<uint8_t>(text[i]));
+        for (int32_t s = keyword_at_[state] >= 0 ? state : dict_link_[state]; s >= 0; s = dict_link_[s]) {
+            int32_t k = keyword_at_[s];
+            found.keywords.emplace_back(found.scanned + i + 1 - keywords_[k].size(), k);
+        }
+    }
+    found.scanned += text.size();
+    found.state = state;
+}
+
+inline void KeywordHighlighter::find(std::string_view text, bool, bool, Scratch* scratch,
+                                     std::vector<Match>& out) const {
+    if (built_ == 0) return;
+
+    auto& found = *static_cast<Found*>(scratch);
+    if (found.scanned < text.size()) scan(text.substr(found.scanned), scratch);
+
+    // Take the keywords greedily from the left, the longest of those
+    // starting at one offset; the segment is done with
+    auto& keywords = found.keywords;
+    std::sort(keywords.begin(), keywords.end(), [this](const auto& a, const auto& b) {
+        return a.first != b.first ? a.first < b.first : keywords_[a.second].size() > keywords_[b.second].size();
+    });
+    size_t end = 0;
+    for (const auto& [begin, k] : keywords) {
+        if (begin < end) continue;
+        end = begin + keywords_[k].size();
+        out.push_back({begin, end, formats_[k]});
+    }
+    keywords.clear();
+    found.scanned = 0;
+    found.state   = ROOT;
+}
@@ -0,0 +1,354 @@
+// optimize.h - Rewrite SGR sequences into the fewest needed
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#include "ansi.h"
+#include "format.h"
+#include "sink.h"
+
+// Sink decorator that tracks the terminal state set by SGR sequences and
+// writes only the changes visible text needs: SGRs with no text after them
+// are merged, no-op resets and repeated colors disappear, and each change
+// is written as the shorter of a relative sequence or a reset-based one.
+//
+// The state is a Format plus what Format cannot express: 256/true colors
+// and unknown attributes, which are passed on as given (a repeated one
+// only once, so the state stays bounded). Other escape sequences pass
+// through unchanged, after any pending SGR change (erasing a line, for
+// example, paints with the current background). Until the first SGR the
+// terminal state is unknown, so the first change starts with a reset; SGRs
+// without one are assumed to apply on top of the default.
+class OptimizeSink : public Sink {
+public:
+    // Sequences longer than this are passed through as they are
+    static constexpr size_t MAX_SEQUENCE = 256;
+
+    explicit OptimizeSink(Sink& out) : out_(out) {}
+
+    void write(std::string_view text) override {
+        while (!text.empty()) {
+            if (escape_ == Escape::NONE) {
+                size_t plain = std::min(text.find('\e'), text.size());
+                if (plain) {
+                    sync();
+                    out_.write(text.substr(0, plain));
+                    text.remove_prefix(plain);
+                    continue;
+                }
+            }
+            put_escape(text[0]);
+            text.remove_prefix(1);
+        }
+    }
+
+    void put(char c) override { write(std::string_view(&c, 1)); }
+
+    void flush() override {
+        if (!sequence_.empty()) pass_sequence();
+        sync();
+        out_.flush();
+    }
+
+private:
+    struct State {
+        Format format = Format::initial();
+        std::string fg_ext; // "38;5;N" and the like, overrides format's fg
+        std::string bg_ext;
+        std::string extra;  // unknown attributes, each once, in order of last appearance
+
+        bool operator==(const State& o) const {
+            return format.fg_color == o.format.fg_color && format.fg_bright == o.format.fg_bright &&
+                   format.bg_color == o.format.bg_color && format.bg_bright == o.format.bg_bright &&
+                   format.style_bits() == o.format.style_bits() && fg_ext == o.fg_ext &&
+                   bg_ext == o.bg_ext && extra == o.extra;
+        }
+    };
+
+    enum class Escape : uint8_t { NONE, ESC, CSI };
+
+    Sink& out_;
+    State wanted_;          // state the input asked for so far
+    State shown_;           // state the terminal is in
+    bool known_   = false;  // shown_ is valid (we have written an SGR)
+    bool changed_ = false;  // wanted_ may differ from shown_
+    Escape escape_ = Escape::NONE;
+    std::string sequence_;  // escape sequence being collected
+    std::string sgr_;       // scratch for the written sequence
+
+    void put_escape(char c) {
+        sequence_ += c;
+        switch (escape_) {
+        case Escape::NONE:
+            escape_ = Escape::ESC; // c == '\e'
+            return;
+        case Escape::ESC:
+            if (c == '[') {
+                escape_ = Escape::CSI;
+                return;
+            }
+            break;
+        case Escape::CSI:
+            if (!(c >= 0x40 && c <= 0x7e)) {
+                if (sequence_.size() >= MAX_SEQUENCE) break;
+                return;
+            }
+            if (c == ansi::ESC_END && apply(std::string_view(sequence_).substr(2, sequence_.size() - 3))) {
+                sequence_.clear();
+                escape_ = Escape::NONE;
+                return;
+            }
+            break;
+        }
+        pass_sequence();
+    }
+
+    void pass_sequence() {
+        sync();
+        out_.write(sequence_);
+        sequence_.clear();
+        escape_ = Escape::NONE;
+    }
+
+    // Apply SGR parameters to wanted_; false if they cannot be parsed
+    bool apply(std::string_view params);
+
+    // Write the change from shown_ to wanted_, if any
+    void sync();
+
+    static void append_code(std::string& out, int code) {
+        char digits[8];
+        auto result = std::to_chars(digits, digits + sizeof(digits), code);
+        if (!out.empty()) out += ansi::SEP;
+        out.append(digits, result.ptr);
+    }
+
+    static void append_codes(std::string& out, std::string_view codes) {
+        if (codes.empty()) return;
+        if (!out.empty()) out += ansi::SEP;
+        out += codes;
+    }
+
+    // Add an unknown code to `extra`. A repeated code only matters as its
+    // last occurrence, so an earlier one is removed rather than kept.
+    static void add_extra(std::string& extra, std::string_view code);
+
+    static void append_styles(std::string& out, uint16_t bits);
+    static void append_fg(std::string& out, const State& s);
+    static void append_bg(std::string& out, const State& s);
+};
+
+// Implementation
+
+inline bool OptimizeSink::apply(std::string_view params) {
+    using namespace syntax::style;
+    State s  = wanted_; // committed only if the whole sequence parses
+    changed_ = true;
+
+    if (params.empty()) {
+        wanted_ = State();
+        return true;
+    }
+
+    // Parameters are separated by ';'; an empty one means 0
+    size_t pos = 0;
+    auto next_param = [&](std::string_view& param) {
+        if (pos > params.size()) return false;
+        size_t end = std::min(params.find(ansi::SEP, pos), params.size());
+        param      = params.substr(pos, end - pos);
+        pos        = end + 1;
+        return true;
+    };
+
+    std::string_view param;
+    while (next_param(param)) {
+        int code = 0;
+        auto result = std::from_chars(param.data(), param.data() + param.size(), code);
+        bool numeric = param.empty() || (result.ec == std::errc() && result.ptr == param.data() + param.size());
+
+        if (numeric && (code == 38 || code == 48)) {
+            // Extended color: 5;N or 2;R;G;B
+            std::string ext(param);
+            std::string_view arg;
+            if (!next_param(arg) || (arg != "5" && arg != "2")) return false;
+            for (int n = arg == "5" ? 1 : 3; n >= 0; --n) {
+                if (arg.empty()) return false;
+                ext += ansi::SEP;
+                ext += arg;
+                if (n && !next_param(arg)) return false;
+            }
+            (code == 38 ? s.fg_ext : s.bg_ext) = std::move(ext);
+        } else if (!numeric) {
+            if (param.substr(0, 3) == "38:") {
+                s.fg_ext = param;
+            } else if (param.substr(0, 3) == "48:") {
+                s.bg_ext = param;
+            } else {
+                add_extra(s.extra, param);
+            }
+        } else if (code >= 30 && code <= 37) {
+            s.format.set_fg(static_cast<Color>(code - 30));
+            s.fg_ext.clear();
+        } else if (code >= 90 && code <= 97) {
+            s.format.set_fg(static_cast<Color>(code - 90), true);
+            s.fg_ext.clear();
+        } else if (code >= 40 && code <= 47) {
+            s.format.set_bg(static_cast<Color>(code - 40));
+            s.bg_ext.clear();
+        } else if (code >= 100 && code <= 107) {
+            s.format.set_bg(static_cast<Color>(code - 100), true);
+            s.bg_ext.clear();
+        } else {
+            uint16_t bits = s.format.style_bits();
+            switch (code) {
+            case ansi::RESET:            s = State(); break;
+            case ansi::BOLD:             bits |= BOLD_BIT; break;
+            case ansi::DIM:              bits |= DIM_BIT; break;
+            case ansi::ITALIC:           bits |= ITALIC_BIT; break;
+            case ansi::UNDERLINE:        bits |= UNDERLINE_BIT; break;
+            case 5:
+            case ansi::BLINK:            bits |= BLINK_BIT; break;
+            case ansi::REVERSED:         bits |= REVERSED_BIT; break;
+            case ansi::STRIKETHROUGH:    bits |= STRIKETHROUGH_BIT; break;
+            case ansi::DOUBLE_UNDERLINE: bits |= DOUBLE_UNDERLINE_BIT; break;
+            case ansi::OVERLINE:         bits |= OVERLINE_BIT; break;
+            case 22: bits &= ~(BOLD_BIT | DIM_BIT); break;
+            case 23: bits &= ~ITALIC_BIT; break;
+            case 24: bits &= ~(UNDERLINE_BIT | DOUBLE_UNDERLINE_BIT); break;
+            case 25: bits &= ~BLINK_BIT; break;
+            case 27: bits &= ~REVERSED_BIT; break;
+            case 29: bits &= ~STRIKETHROUGH_BIT; break;
+            case 55: bits &= ~OVERLINE_BIT; break;
+            case 39:
+                s.format.set_fg(DEFAULT);
+                s.fg_ext.clear();
+                break;
+            case 49:
+                s.format.set_bg(DEFAULT);
+                s.bg_ext.clear();
+                break;
+            default:
+                add_extra(s.extra, param);
+                break;
+            }
+            if (code != ansi::RESET) s.format.set_style_bits(bits);
+        }
+    }
+    wanted_ = std::move(s);
+    return true;
+}
+
+inline void OptimizeSink::add_extra(std::string& extra, std::string_view code) {
+    for (size_t pos = 0; pos < extra.size();) {
+        size_t end = std::min(extra.find(ansi::SEP, pos), extra.size());
+        if (std::string_view(extra).substr(pos, end - pos) == code) {
+            // Remove it with one of its separators
+            if (end < extra.size()) {
+                extra.erase(pos, end + 1 - pos);
+            } else {
+                extra.erase(pos ? pos - 1 : 0);
+            }
+            break;
+        }
+        pos = end + 1;
+    }
+    append_codes(extra, code);
+}
+
+inline void OptimizeSink::append_styles(std::string& out, uint16_t bits) {
+    using namespace syntax::style;
+    if (bits & BOLD_BIT)             append_code(out, ansi::BOLD);
+    if (bits & DIM_BIT)              append_code(out, ansi::DIM);
+    if (bits & ITALIC_BIT)           append_code(out, ansi::ITALIC);
+    if (bits & UNDERLINE_BIT)        append_code(out, ansi::UNDERLINE);
+    if (bits & BLINK_BIT)            append_code(out, ansi::BLINK);
+    if (bits & REVERSED_BIT)         append_code(out, ansi::REVERSED);
+    if (bits & STRIKETHROUGH_BIT)    append_code(out, ansi::STRIKETHROUGH);
+    if (bits & DOUBLE_UNDERLINE_BIT) append_code(out, ansi::DOUBLE_UNDERLINE);
+    if (bits & OVERLINE_BIT)         append_code(out, ansi::OVERLINE);
+}
+
+inline void OptimizeSink::append_fg(std::string& out, const State& s) {
+    if (!s.fg_ext.empty()) {
+        append_codes(out, s.fg_ext);
+    } else {
+        append_code(out, ansi::FG_BASE + s.format.fg_color + (s.format.fg_bright ? ansi::BRIGHT_OFFSET : 0));
+    }
+}
+
+inline void OptimizeSink::append_bg(std::string& out, const State& s) {
+    if (!s.bg_ext.empty()) {
+        append_codes(out, s.bg_ext);
+    } else {
+        append_code(out, ansi::BG_BASE + s.format.bg_color + (s.format.bg_bright ? ansi::BRIGHT_OFFSET : 0));
+    }
+}
+
+inline void OptimizeSink::sync() {
+    using namespace syntax::style;
+    if (!changed_) return;
+    changed_ = false;
+    if (known_ && wanted_ == shown_) return;
+
+    const State& to = wanted_;
+    const Format& f = to.format;
+
+    // From scratch: reset, then everything that is not a default
+    std::string full;
+    append_code(full, ansi::RESET);
+    append_styles(full, f.style_bits());
+    if (f.fg_color != DEFAULT || !to.fg_ext.empty()) append_fg(full, to);
+    if (f.bg_color != DEFAULT || !to.bg_ext.empty()) append_bg(full, to);
+    append_codes(full, to.extra);
+
+    // Relative to what is shown; unknown attributes cannot be turned off,
+    // only added after those shown
+    std::string_view added(to.extra);
+    bool extends = added.starts_with(shown_.extra) &&
+                   (shown_.extra.empty() || added.size() == shown_.extra.size() ||
+                    added[shown_.extra.size()] == ansi::SEP);
+    added.remove_prefix(std::min(added.size(), shown_.extra.size() + !shown_.extra.empty()));
+    sgr_.clear();
+    if (known_ && extends) {
+        uint16_t from_bits = shown_.format.style_bits();
+        uint16_t to_bits   = f.style_bits();
+        uint16_t off       = from_bits & ~to_bits;
+        uint16_t on        = to_bits & ~from_bits;
+
+        // Some attributes share an off code; turn the survivor back on
+        if (off & (BOLD_BIT | DIM_BIT)) {
+            append_code(sgr_, 22);
+            on |= to_bits & (BOLD_BIT | DIM_BIT);
+        }
+        if (off & (UNDERLINE_BIT | DOUBLE_UNDERLINE_BIT)) {
+            append_code(sgr_, 24);
+            on |= to_bits & (UNDERLINE_BIT | DOUBLE_UNDERLINE_BIT);
+        }
+        if (off & ITALIC_BIT)        append_code(sgr_, 23);
+        if (off & BLINK_BIT)         append_code(sgr_, 25);
+        if (off & REVERSED_BIT)      append_code(sgr_, 27);
+        if (off & STRIKETHROUGH_BIT) append_code(sgr_, 29);
+        if (off & OVERLINE_BIT)      append_code(sgr_, 55);
+        append_styles(sgr_, on);
+
+        const Format& from = shown_.format;
+        if (from.fg_color != f.fg_color || from.fg_bright != f.fg_bright || shown_.fg_ext != to.fg_ext) {
+            append_fg(sgr_, to);
+        }
+        if (from.bg_color != f.bg_color || from.bg_bright != f.bg_bright || shown_.bg_ext != to.bg_ext) {
+            append_bg(sgr_, to);
+        }
+        append_codes(sgr_, added);
+    }
+    if (sgr_.empty() || full.size() <= sgr_.size()) sgr_.swap(full);
+
+    out_.write(ansi::ESC_START);
+    out_.write(sgr_);
+    out_.put(ansi::ESC_END);
+    shown_ = wanted_;
+    known_ = true;
+}
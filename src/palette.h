@@ -0,0 +1,136 @@
+// palette.h - SGR color codes per logical color, remappable
+#pragma once
+
+#include <array>
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+#include "alphabet.h"
+#include "ansi.h"
+#include "config_file.h"
+#include "syntax.h"
+
+// The SGR parameters each logical color (the 8 colors, their bright
+// variants and DEFAULT) is rendered with, for foreground and background.
+// Format::to_ansi() appends these strings as they are, so a remapped color,
+// 256-color or true color included, costs nothing extra per tag.
+class Palette {
+public:
+    // The standard codes: 30-37, 90-97 and 39 (40-47, 100-107 and 49)
+    Palette() {
+        for (uint8_t color = 0; color < 16; ++color) {
+            for (bool bright : {false, true}) {
+                int offset = color + (bright ? ansi::BRIGHT_OFFSET : 0);
+                fg_[index(color, bright)] = std::to_string(ansi::FG_BASE + offset);
+                bg_[index(color, bright)] = std::to_string(ansi::BG_BASE + offset);
+            }
+        }
+    }
+
+    static const Palette& standard() {
+        static const Palette palette;
+        return palette;
+    }
+
+    std::string_view fg(uint8_t color, bool bright) const { return fg_[index(color, bright)]; }
+    std::string_view bg(uint8_t color, bool bright) const { return bg_[index(color, bright)]; }
+
+    // Remap the color named by `key` ('r', 'R', 'd', ... as in specifiers of
+    // `alphabet`) to `value`: another color name, a 256-color index or
+    // "#RRGGBB". False and `error` if either cannot be parsed.
+    bool set(std::string_view key, std::string_view value, bool fg, bool bg, std::string& error,
+             const SpecifierAlphabet& alphabet = SpecifierAlphabet::standard());
+
+    // Read "[fg:|bg:]COLOR VALUE" lines, e.g. "r #ff5f5f", "G 114" or
+    // "bg:d k"; without a prefix both are remapped. Blank lines and lines
+    // starting with '#' are skipped. Returns false and fills `error` on the
+    // first invalid line. Color names are those of `alphabet`.
+    bool load(FILE* file, std::string& error, const SpecifierAlphabet& alphabet = SpecifierAlphabet::standard());
+
+private:
+    std::array<std::string, 32> fg_;
+    std::array<std::string, 32> bg_;
+
+    static size_t index(uint8_t color, bool bright) { return color | (bright ? 16 : 0); }
+
+    // A color name as in specifiers of `alphabet`: index() of it, or -1
+    static int parse_name(std::string_view name, const SpecifierAlphabet& alphabet);
+};
+
+// Implementation
+
+inline int Palette::parse_name(std::string_view name, const SpecifierAlphabet& alphabet) {
+    if (name.size() != 1) return -1;
+    const auto& action = alphabet[static_cast<uint8_t>(name[0])];
+    if (action.kind != SpecifierAlphabet::Action::COLOR || action.value == CURRENT) return -1;
+    return action.value; // Color | 16 if bright, as index()
+}
+
+inline bool Palette::set(std::string_view key, std::string_view value, bool fg, bool bg, std::string& error,
+                         const SpecifierAlphabet& alphabet) {
+    int target = parse_name(key, alphabet);
+    if (target < 0) {
+        error = "unknown color '" + std::string(key) + "'";
+        return false;
+    }
+
+    std::string fg_code, bg_code;
+    if (int source = parse_name(value, alphabet); source >= 0) {
+        fg_code = standard().fg_[static_cast<size_t>(source)];
+        bg_code = standard().bg_[static_cast<size_t>(source)];
+    } else if (value.size() == 7 && value[0] == '#') {
+        std::string rgb;
+        for (size_t i = 1; i < 7; i += 2) {
+            unsigned channel = 0;
+            auto result = std::from_chars(value.data() + i, value.data() + i + 2, channel, 16);
+            if (result.ec != std::errc() || result.ptr != value.data() + i + 2) {
+                error = "invalid color value '" + std::string(value) + "'";
+                return false;
+            }
+            rgb += ansi::SEP + std::to_string(channel);
+        }
+        fg_code = "38;2" + rgb;
+        bg_code = "48;2" + rgb;
+    } else {
+        unsigned n = 0;
+        auto result = std::from_chars(value.data(), value.data() + value.size(), n);
+        if (value.empty() || result.ec != std::errc() || result.ptr != value.data() + value.size() || n > 255) {
+            error = "invalid color value '" + std::string(value) + "'";
+            return false;
+        }
+        fg_code = "38;5;" + std::to_string(n);
+        bg_code = "48;5;" + std::to_string(n);
+    }
+
+    if (fg) fg_[static_cast<size_t>(target)] = fg_code;
+    if (bg) bg_[static_cast<size_t>(target)] = bg_code;
+    return true;
+}
+
+inline bool Palette::load(FILE* file, std::string& error, const SpecifierAlphabet& alphabet) {
+    return read_config_lines(file, error, [this, &alphabet](std::string_view line, std::string& why) {
+        std::string_view entry = line.substr(line.find_first_not_of(" \t"));
+        entry                  = entry.substr(0, entry.find_last_not_of(" \t") + 1);
+
+        size_t space = entry.find_first_of(" \t");
+        size_t value = space == std::string_view::npos ? space : entry.find_first_not_of(" \t", space);
+        if (value == std::string_view::npos || entry.find_first_of(" \t", value) != std::string_view::npos) {
+            why = "expected '[fg:|bg:]COLOR VALUE', got '" + std::string(line) + "'";
+            return false;
+        }
+
+        std::string_view key = entry.substr(0, space);
+        bool fg = true, bg = true;
+        if (key.substr(0, 3) == "fg:") {
+            bg = false;
+            key.remove_prefix(3);
+        } else if (key.substr(0, 3) == "bg:") {
+            fg = false;
+            key.remove_prefix(3);
+        }
+        return set(key, entry.substr(value), fg, bg, why, alphabet);
+    });
+}
@@ -0,0 +1,142 @@
+// perf.h - Hardware performance counters around a piece of work
+#pragma once
+
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#if defined(__linux__) && __has_include(<linux/perf_event.h>)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define FORMATTER_HAVE_PERF 1
+#endif
+
+// Counts cycles, instructions, branch misses and cache misses of this
+// process (user space only) between start() and stop(), through Linux
+// perf_event_open. Each event is opened on its own, so one the CPU or the
+// kernel does not offer leaves the others usable; when none can be opened
+// (no PMU in a VM, perf_event_paranoid, seccomp, another OS) available()
+// is false and error() says why. Counts are scaled up if the kernel had
+// to multiplex the counters.
+class PerfCounters {
+public:
+    enum Event { CYCLES, INSTRUCTIONS, BRANCH_MISSES, CACHE_MISSES, NUM_EVENTS };
+
+    static constexpr const char* NAMES[NUM_EVENTS] = {"cycles", "instructions", "branch-misses", "cache-misses"};
+
+    PerfCounters();
+    ~PerfCounters();
+    PerfCounters(const PerfCounters&)            = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    bool available() const { return available_; }
+    const std::string& error() const { return error_; }
+
+    // Whether `event` was counted; its value is 0 otherwise
+    bool has(Event event) const { return fds_[event] >= 0; }
+    uint64_t value(Event event) const { return values_[event]; }
+    const std::array<uint64_t, NUM_EVENTS>& values() const { return values_; }
+
+    // Zero and enable the counters / disable them and read the counts
+    void start();
+    void stop();
+
+    // Print each counted event, per `bytes` of input, one per line
+    void print(FILE* stream, const char* prefix, uint64_t bytes) const;
+
+private:
+    std::array<int, NUM_EVENTS> fds_;
+    std::array<uint64_t, NUM_EVENTS> values_{};
+    bool available_ = false;
+    std::string error_;
+};
+
+// Implementation
+
+#ifdef FORMATTER_HAVE_PERF
+
+inline PerfCounters::PerfCounters() {
+    static constexpr uint64_t CONFIGS[NUM_EVENTS] = {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_BRANCH_MISSES,
+        PERF_COUNT_HW_CACHE_MISSES,
+    };
+    for (int i = 0; i < NUM_EVENTS; ++i) {
+        perf_event_attr attr{};
+        attr.size           = sizeof(attr);
+        attr.type           = PERF_TYPE_HARDWARE;
+        attr.config         = CONFIGS[i];
+        attr.disabled       = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv     = 1;
+        attr.read_format    = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        fds_[i] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC));
+        if (fds_[i] >= 0) {
+            available_ = true;
+        } else if (error_.empty()) {
+            error_ = std::strerror(errno);
+        }
+    }
+    if (available_) error_.clear();
+}
+
+inline PerfCounters::~PerfCounters() {
+    for (int fd : fds_) {
+        if (fd >= 0) close(fd);
+    }
+}
+
+inline void PerfCounters::start() {
+    for (int fd : fds_) {
+        if (fd < 0) continue;
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+}
+
+inline void PerfCounters::stop() {
+    for (int i = 0; i < NUM_EVENTS; ++i) {
+        values_[i] = 0;
+        if (fds_[i] < 0) continue;
+        ioctl(fds_[i], PERF_EVENT_IOC_DISABLE, 0);
+
+        uint64_t data[3]; // value, time enabled, time running
+        if (read(fds_[i], data, sizeof(data)) != sizeof(data) || !data[2]) continue;
+        values_[i] = data[2] < data[1]
+                         ? static_cast<uint64_t>(static_cast<double>(data[0]) * data[1] / data[2])
+                         : data[0];
+    }
+}
+
+#else
+
+inline PerfCounters::PerfCounters() : error_("not supported on this platform") { fds_.fill(-1); }
+inline PerfCounters::~PerfCounters() = default;
+inline void PerfCounters::start() {}
+inline void PerfCounters::stop() {}
+
+#endif
+
+inline void PerfCounters::print(FILE* stream, const char* prefix, uint64_t bytes) const {
+    if (!available_) {
+        std::fprintf(stream, "%scounters unavailable: %s\n", prefix, error_.c_str());
+        return;
+    }
+    double per = bytes ? static_cast<double>(bytes) : 1.0;
+    for (int i = 0; i < NUM_EVENTS; ++i) {
+        if (!has(static_cast<Event>(i))) continue;
+        std::fprintf(stream, "%s%-14s %14llu  %8.3f/byte", prefix, NAMES[i],
+                     static_cast<unsigned long long>(values_[i]), static_cast<double>(values_[i]) / per);
+        if (i == INSTRUCTIONS && has(CYCLES) && values_[CYCLES]) {
+            std::fprintf(stream, "  (%.2f IPC)", static_cast<double>(values_[i]) / static_cast<double>(values_[CYCLES]));
+        }
+        std::fputc('\n', stream);
+    }
+}
@@ -0,0 +1,315 @@
+// profile.h - Statistical profiles of inputs, and inputs synthesized from them
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <random>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "automaton.h"
+#include "config_file.h"
+#include "tag_syntax.h"
+
+// What an input looks like to the formatter, without its content: size,
+// line lengths, tag density, nesting depth of tags, which specifiers occur
+// and which escapes. A profile can be shared where the input cannot, and
+// generate() turns it back into an input with the same statistics for
+// benchmarks.
+//
+// To record, pass the raw input to record() and attach the profile as the
+// observer of the automaton that parses it; finish() at the end.
+class InputProfile : public MarkupObserver {
+public:
+    static constexpr size_t LENGTH_BUCKETS = 24; // 0, 1, 2-3, 4-7, ... bytes
+    static constexpr size_t MAX_DEPTH      = 16; // deeper tags count as this deep
+    static constexpr size_t MAX_SPECIFIERS = 256;
+
+    void record(std::string_view input);
+    void finish();
+
+    void tag(std::string_view specifier, size_t depth) override;
+    void escape(char kind) override;
+
+    uint64_t bytes() const { return bytes_; }
+    uint64_t lines() const { return lines_; }
+    uint64_t tags() const { return tags_; }
+    uint64_t escapes() const { return escapes_; }
+
+    // As "KEY COUNT [WHAT]" lines, see load()
+    std::string to_text() const;
+
+    // Read what to_text() writes; lines starting with '#' are skipped.
+    // Returns false and fills `error` on the first invalid line.
+    bool load(FILE* file, std::string& error);
+
+    // About `bytes` bytes of log-like lines in `syntax` (escapes for -e if
+    // the profile has any) with this profile's statistics. The profile does
+    // not record the syntax: pass the one the input was profiled with.
+    std::string generate(size_t bytes, uint32_t seed = 42, const TagSyntax& syntax = TagSyntax::CLASSIC) const;
+
+private:
+    uint64_t bytes_   = 0;
+    uint64_t lines_   = 0;
+    uint64_t tags_    = 0;
+    uint64_t escapes_ = 0;
+    std::array<uint64_t, LENGTH_BUCKETS> lengths_{};
+    std::array<uint64_t, MAX_DEPTH + 1> depths_{};
+    std::map<std::string, uint64_t, std::less<>> specifiers_;
+    std::array<uint64_t, 256> escape_kinds_{};
+    uint64_t line_length_ = 0; // of the line being recorded
+
+    static size_t bucket(uint64_t length) {
+        return std::min<size_t>(static_cast<size_t>(std::bit_width(length)), LENGTH_BUCKETS - 1);
+    }
+    static uint64_t bucket_min(size_t b) { return b ? uint64_t{1} << (b - 1) : 0; }
+
+    void add_line(uint64_t length) {
+        ++lines_;
+        ++lengths_[bucket(length)];
+    }
+
+    static bool parse_number(std::string_view text, uint64_t& value) {
+        auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+        return !text.empty() && result.ec == std::errc() && result.ptr == text.data() + text.size();
+    }
+
+    // One loaded line; false if `key` is unknown or `what` does not fit it
+    bool store(std::string_view key, uint64_t count, std::string_view what);
+};
+
+// Implementation
+
+inline void InputProfile::record(std::string_view input) {
+    bytes_ += input.size();
+    while (const void* nl = std::memchr(input.data(), '\n', input.size())) {
+        size_t len = static_cast<size_t>(static_cast<const char*>(nl) - input.data());
+        add_line(line_length_ + len);
+        line_length_ = 0;
+        input.remove_prefix(len + 1);
+    }
+    line_length_ += input.size();
+}
+
+inline void InputProfile::finish() {
+    if (line_length_) add_line(line_length_);
+    line_length_ = 0;
+}
+
+inline void InputProfile::tag(std::string_view specifier, size_t depth) {
+    ++tags_;
+    ++depths_[std::min(depth, MAX_DEPTH)];
+    auto it = specifiers_.find(specifier);
+    if (it != specifiers_.end()) {
+        ++it->second;
+    } else if (specifiers_.size() < MAX_SPECIFIERS) {
+        specifiers_.emplace(specifier, 1);
+    }
+}
+
+inline void InputProfile::escape(char kind) {
+    ++escapes_;
+    ++escape_kinds_[static_cast<uint8_t>(kind)];
+}
+
+inline std::string InputProfile::to_text() const {
+    std::string out = "# formatter input profile: statistics only, no content\n"
+                      "# line-length COUNT MIN: lines of MIN to 2*MIN-1 bytes\n"
+                      "# depth COUNT DEPTH, specifier COUNT SPECIFIER, escape COUNT CHAR\n";
+    auto add = [&out](const char* key, uint64_t count, std::string_view what = {}) {
+        out += key;
+        out += ' ';
+        out += std::to_string(count);
+        if (!what.empty()) {
+            out += ' ';
+            out += what;
+        }
+        out += '\n';
+    };
+
+    add("bytes", bytes_);
+    add("lines", lines_);
+    add("tags", tags_);
+    add("escapes", escapes_);
+    for (size_t b = 0; b < LENGTH_BUCKETS; ++b) {
+        if (lengths_[b]) add("line-length", lengths_[b], std::to_string(bucket_min(b)));
+    }
+    for (size_t d = 0; d <= MAX_DEPTH; ++d) {
+        if (depths_[d]) add("depth", depths_[d], std::to_string(d));
+    }
+
+    // Most frequent first
+    std::vector<std::pair<std::string_view, uint64_t>> specifiers(specifiers_.begin(), specifiers_.end());
+    std::stable_sort(specifiers.begin(), specifiers.end(),
+                     [](const auto& a, const auto& b) { return a.second > b.second; });
+    for (const auto& [specifier, count] : specifiers) add("specifier", count, specifier);
+
+    for (size_t c = 0; c < escape_kinds_.size(); ++c) {
+        if (escape_kinds_[c]) add("escape", escape_kinds_[c], std::string(1, static_cast<char>(c)));
+    }
+    return out;
+}
+
+inline bool InputProfile::load(FILE* file, std::string& error) {
+    *this = InputProfile();
+    return read_config_lines(file, error, [this](std::string_view line, std::string& why) {
+        // KEY COUNT [WHAT]; WHAT may be empty (a tag without specifier)
+        size_t space          = std::min(line.find(' '), line.size());
+        std::string_view key  = line.substr(0, space);
+        std::string_view rest = line.substr(std::min(space + 1, line.size()));
+        size_t end            = std::min(rest.find(' '), rest.size());
+        std::string_view what = rest.substr(std::min(end + 1, rest.size()));
+
+        uint64_t count = 0;
+        if (!parse_number(rest.substr(0, end), count) || !store(key, count, what)) {
+            why = "expected 'KEY COUNT [WHAT]', got '" + std::string(line) + "'";
+            return false;
+        }
+        return true;
+    });
+}
+
+inline bool InputProfile::store(std::string_view key, uint64_t count, std::string_view what) {
+    uint64_t n   = 0;
+    bool numeric = parse_number(what, n);
+    if (key == "bytes") {
+        bytes_ = count;
+    } else if (key == "lines") {
+        lines_ = count;
+    } else if (key == "tags") {
+        tags_ = count;
+    } else if (key == "escapes") {
+        escapes_ = count;
+    } else if (key == "line-length" && numeric) {
+        lengths_[bucket(n)] += count;
+    } else if (key == "depth" && numeric) {
+        depths_[std::min<uint64_t>(n, MAX_DEPTH)] += count;
+    } else if (key == "specifier") {
+        specifiers_[std::string(what)] += count;
+    } else if (key == "escape" && what.size() == 1) {
+        escape_kinds_[static_cast<uint8_t>(what[0])] += count;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+inline std::string InputProfile::generate(size_t bytes, uint32_t seed, const TagSyntax& syntax) const {
+    std::mt19937 rng(seed);
+    auto weights = [](auto first, auto last) {
+        std::vector<double> w(first, last);
+        if (std::all_of(w.begin(), w.end(), [](double x) { return x == 0; })) w.assign(w.size(), 1);
+        return std::discrete_distribution<size_t>(w.begin(), w.end());
+    };
+    auto lengths = weights(lengths_.begin(), lengths_.end());
+    auto depths  = weights(depths_.begin() + 1, depths_.end()); // depth 1 and up
+
+    std::vector<std::string_view> names;
+    std::vector<double> counts;
+    for (const auto& [specifier, count] : specifiers_) {
+        names.push_back(specifier);
+        counts.push_back(static_cast<double>(count));
+    }
+    if (names.empty()) {
+        names.push_back("r");
+        counts.push_back(1);
+    }
+    std::discrete_distribution<size_t> specifiers(counts.begin(), counts.end());
+
+    std::vector<char> kinds;
+    counts.clear();
+    for (size_t c = 0; c < escape_kinds_.size(); ++c) {
+        if (!escape_kinds_[c]) continue;
+        kinds.push_back(static_cast<char>(c));
+        counts.push_back(static_cast<double>(escape_kinds_[c]));
+    }
+    std::discrete_distribution<size_t> escape_kinds(counts.begin(), counts.end());
+
+    // Events per byte of input
+    double per_byte    = bytes_ ? 1.0 / static_cast<double>(bytes_) : 0;
+    double tag_rate    = static_cast<double>(tags_) * per_byte;
+    double escape_rate = kinds.empty() ? 0 : static_cast<double>(escapes_) * per_byte;
+
+    // Text between markup: log-like words, none of the characters of the
+    // predefined syntaxes
+    static constexpr std::string_view TEXT = "abcdefghijklmnopqrstuvwxyz0123456789abcdefghijklmnopqrstuvwxyz:=./";
+
+    std::string out;
+    out.reserve(bytes + 256);
+    std::vector<bool> is_tag; // the markup events of a line, in order
+    std::string markup;       // their bytes, then the closing tags
+    std::vector<size_t> ends; // end of each event in markup
+    std::vector<uint64_t> at; // text bytes before each event
+    while (out.size() < bytes) {
+        size_t b        = lengths(rng);
+        uint64_t low    = bucket_min(b);
+        uint64_t high   = b ? 2 * low - 1 : 0;
+        uint64_t length = std::uniform_int_distribution<uint64_t>(low, high)(rng);
+
+        double expected  = static_cast<double>(length + 1);
+        auto num_tags    = std::poisson_distribution<unsigned>(tag_rate * expected)(rng);
+        auto num_escapes = std::poisson_distribution<unsigned>(escape_rate * expected)(rng);
+        is_tag.assign(num_tags, true);
+        is_tag.resize(num_tags + num_escapes, false);
+        std::shuffle(is_tag.begin(), is_tag.end(), rng);
+
+        // The markup first: the profiled lengths include it, so only what
+        // is left of `length` is text
+        markup.clear();
+        ends.clear();
+        size_t depth = 0;
+        auto open    = [&](std::string_view specifier) {
+            markup += syntax.open_tag;
+            markup += specifier;
+            markup += syntax.open_end;
+            ++depth;
+        };
+        for (bool tag : is_tag) {
+            if (!tag) {
+                char kind = kinds[escape_kinds(rng)];
+                markup += '\\';
+                markup += kind;
+                if (kind == 'x') markup += "41";
+                if (kind == 'u') markup += "00e9";
+                if (kind >= '0' && kind <= '3') markup += "12";
+                if (kind >= '4' && kind <= '7') markup += "1";
+            } else {
+                size_t target = depths(rng) + 1;
+                for (; depth >= target; --depth) markup += syntax.close_tag;
+                while (depth + 1 < target) open(names[specifiers(rng)]);
+                open(names[specifiers(rng)]);
+            }
+            ends.push_back(markup.size());
+        }
+        for (; depth > 0; --depth) markup += syntax.close_tag;
+
+        uint64_t text = length - std::min<uint64_t>(length, markup.size());
+        std::uniform_int_distribution<uint64_t> position(0, text);
+        at.clear();
+        for (size_t i = 0; i < ends.size(); ++i) at.push_back(position(rng));
+        std::sort(at.begin(), at.end());
+
+        uint64_t written = 0;
+        auto fill        = [&](uint64_t until) {
+            for (; written < until; ++written) out += (rng() % 6 == 0) ? ' ' : TEXT[rng() % TEXT.size()];
+        };
+        size_t from = 0;
+        for (size_t i = 0; i < ends.size(); ++i) {
+            fill(at[i]);
+            out.append(markup, from, ends[i] - from);
+            from = ends[i];
+        }
+        fill(text);
+        out.append(markup, from);
+        out += '\n';
+    }
+    return out;
+}
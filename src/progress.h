@@ -0,0 +1,109 @@
+// progress.h - Throughput and progress reports on stderr
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+// Reports how far processing of a stream has got, once per interval: input
+// bytes so far, the current MB/s and tags/s, the share of time spent waiting
+// for input (high: the source is the bottleneck, low: the formatter or its
+// output is), and with a known total the percentage and ETA. The caller
+// passes its running counters after each chunk, so the cost is a clock read
+// or two per chunk, nothing per byte.
+//
+// On a terminal the report is redrawn in place; otherwise (a log file) each
+// report is a line of its own.
+class ProgressMeter {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // `total` is the expected number of bytes, 0 if unknown
+    ProgressMeter(FILE* stream, bool terminal, uint64_t total = 0,
+                  Clock::duration interval = std::chrono::seconds(1))
+        : stream_(stream), terminal_(terminal), total_(total), interval_(interval) {
+        start_ = last_ = idle_since_ = Clock::now();
+    }
+
+    // A chunk of input has arrived: the time since the previous update() was
+    // spent waiting for it
+    void input_ready() {
+        auto now = Clock::now();
+        waiting_ += now - idle_since_;
+    }
+
+    // The chunk is processed; `bytes` and `tags` count from the start
+    void update(uint64_t bytes, uint64_t tags) {
+        idle_since_ = Clock::now();
+        if (idle_since_ - last_ >= interval_) report(bytes, tags, idle_since_);
+    }
+
+    // Final report, covering the whole run
+    void finish(uint64_t bytes, uint64_t tags);
+
+private:
+    FILE* stream_;
+    const bool terminal_;
+    const uint64_t total_;
+    const Clock::duration interval_;
+
+    Clock::time_point start_, last_, idle_since_;
+    Clock::duration waiting_{};      // waiting for input since the last report
+    Clock::duration total_waiting_{};
+    uint64_t last_bytes_ = 0;
+    uint64_t last_tags_  = 0;
+
+    void report(uint64_t bytes, uint64_t tags, Clock::time_point now);
+    void print(uint64_t bytes, double seconds, uint64_t new_bytes, uint64_t new_tags, Clock::duration waiting,
+               double eta);
+};
+
+// Implementation
+
+inline void ProgressMeter::report(uint64_t bytes, uint64_t tags, Clock::time_point now) {
+    std::chrono::duration<double> since_start = now - start_;
+    double eta = -1;
+    if (total_ && bytes && bytes < total_) {
+        eta = since_start.count() * static_cast<double>(total_ - bytes) / static_cast<double>(bytes);
+    }
+
+    std::chrono::duration<double> seconds = now - last_;
+    print(bytes, seconds.count(), bytes - last_bytes_, tags - last_tags_, waiting_, eta);
+
+    total_waiting_ += waiting_;
+    waiting_    = {};
+    last_       = now;
+    last_bytes_ = bytes;
+    last_tags_  = tags;
+}
+
+inline void ProgressMeter::finish(uint64_t bytes, uint64_t tags) {
+    auto now = Clock::now();
+    std::chrono::duration<double> seconds = now - start_;
+    print(bytes, seconds.count(), bytes, tags, total_waiting_ + waiting_, -1);
+    if (terminal_) std::fputc('\n', stream_);
+    std::fflush(stream_);
+}
+
+inline void ProgressMeter::print(uint64_t bytes, double seconds, uint64_t new_bytes, uint64_t new_tags,
+                                 Clock::duration waiting, double eta) {
+    constexpr double MB = 1024 * 1024;
+    if (seconds <= 0) seconds = 1e-9;
+    std::chrono::duration<double> waited = waiting;
+
+    std::fprintf(stream_, "%sprogress: %10.1f MB  %8.1f MB/s  %10.0f tags/s  %3.0f%% waiting for input",
+                 terminal_ ? "\r" : "", static_cast<double>(bytes) / MB,
+                 static_cast<double>(new_bytes) / MB / seconds, static_cast<double>(new_tags) / seconds,
+                 std::min(100.0, waited.count() / seconds * 100));
+    if (total_) {
+        double percent = static_cast<double>(bytes) * 100 / static_cast<double>(total_);
+        std::fprintf(stream_, "  %5.1f%%", std::min(100.0, percent));
+        if (eta >= 0) {
+            auto s = static_cast<unsigned long>(eta + 0.5);
+            std::fprintf(stream_, "  ETA %lu:%02lu:%02lu", s / 3600, s / 60 % 60, s % 60);
+        }
+    }
+    std::fputs(terminal_ ? "\033[K" : "\n", stream_);
+    std::fflush(stream_);
+}
@@ -0,0 +1,142 @@
+// pull.h - Pull-based rendering: the consumer asks for bounded output chunks
+#pragma once
+
+#include <algorithm>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "automaton.h"
+#include "sink.h"
+#include "tag_syntax.h"
+
+// Renders input only when the consumer asks for output. The automaton is
+// resumable per byte, so rendering stops as soon as a chunk is full and the
+// rest of the input waits until the next call.
+//
+//     ChunkRenderer r(false, false, true, TagSyntax::CLASSIC, 4096);
+//     r.feed(data);               // view must stay valid until consumed
+//     r.close();                  // no more input after this one
+//     while (!r.done()) write(r.next());
+class ChunkRenderer {
+public:
+    ChunkRenderer(bool strip, bool escape, bool sanitize, const TagSyntax& syntax = TagSyntax::CLASSIC,
+                  size_t chunk_size = 4096)
+        : chunk_size_(chunk_size ? chunk_size : 1), sink_(pending_),
+          automaton_(strip, escape, sanitize, syntax, sink_) {}
+
+    // Queue more input; only valid once the previous input is consumed
+    void feed(std::string_view input) { input_ = input; }
+
+    // Mark end of input; the final reset is rendered by subsequent next() calls
+    void close() { closed_ = true; }
+
+    // True when next() cannot make progress without feed() or close()
+    bool needs_input() const {
+        return input_.empty() && !closed_ && pending_.size() - offset_ < chunk_size_;
+    }
+
+    // True once all input and the final reset have been handed out
+    bool done() const { return closed_ && input_.empty() && finished_ && offset_ == pending_.size(); }
+
+    // Next chunk of at most chunk_size bytes; empty when input is needed or done.
+    // The view stays valid until the next call.
+    std::string_view next() {
+        pending_.erase(0, offset_);
+        offset_ = 0;
+
+        size_t i = 0;
+        while (i < input_.size() && pending_.size() < chunk_size_) {
+            automaton_.accept(static_cast<unsigned char>(input_[i++]));
+        }
+        input_.remove_prefix(i);
+
+        if (input_.empty() && closed_ && !finished_ && pending_.size() < chunk_size_) {
+            automaton_.finish();
+            finished_ = true;
+        }
+
+        offset_ = std::min(pending_.size(), chunk_size_);
+        return std::string_view(pending_).substr(0, offset_);
+    }
+
+private:
+    const size_t chunk_size_;
+    std::string pending_;       // rendered but not yet handed out
+    size_t offset_ = 0;         // bytes of pending_ returned by last next()
+    std::string_view input_;
+    bool closed_   = false;
+    bool finished_ = false;
+    StringSink sink_;
+    FormatterAutomaton automaton_;
+};
+
+// Minimal synchronous generator (std::generator is C++23)
+template <typename T>
+class Generator {
+public:
+    struct promise_type {
+        T current{};
+
+        Generator get_return_object() { return Generator(Handle::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        std::suspend_always yield_value(T value) {
+            current = std::move(value);
+            return {};
+        }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+
+    using Handle = std::coroutine_handle<promise_type>;
+
+    class iterator {
+    public:
+        explicit iterator(Handle h) : handle_(h) {}
+
+        const T& operator*() const { return handle_.promise().current; }
+        iterator& operator++() {
+            handle_.resume();
+            return *this;
+        }
+        bool operator==(std::default_sentinel_t) const { return !handle_ || handle_.done(); }
+
+    private:
+        Handle handle_;
+    };
+
+    explicit Generator(Handle h) : handle_(h) {}
+    Generator(Generator&& other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+    Generator(const Generator&)            = delete;
+    Generator& operator=(const Generator&) = delete;
+    ~Generator() {
+        if (handle_) handle_.destroy();
+    }
+
+    iterator begin() {
+        if (handle_) handle_.resume();
+        return iterator(handle_);
+    }
+    std::default_sentinel_t end() const { return {}; }
+
+private:
+    Handle handle_;
+};
+
+// Yield rendered chunks of at most chunk_size bytes; rendering advances only
+// as the consumer iterates. `input` and `syntax` must outlive the generator.
+inline Generator<std::string_view> render_chunks(std::string_view input, bool strip, bool escape,
+                                                 bool sanitize, const TagSyntax& syntax = TagSyntax::CLASSIC,
+                                                 size_t chunk_size = 4096) {
+    ChunkRenderer renderer(strip, escape, sanitize, syntax, chunk_size);
+    renderer.feed(input);
+    renderer.close();
+    while (!renderer.done()) {
+        std::string_view chunk = renderer.next();
+        if (!chunk.empty()) co_yield chunk; // e.g. nothing to render in strip mode
+    }
+}
@@ -0,0 +1,692 @@
+// regex.h - Multi-pattern regular expressions matched with a lazily built DFA
+#pragma once
+
+#include <algorithm>
+#include <bitset>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// A set of patterns compiled into one NFA. Matching runs a DFA whose states
+// are built on first use and cached, so each input byte costs one table
+// lookup (and a copy of the live start offsets, see Matcher) no matter how
+// many patterns there are.
+//
+// Supported syntax: literals, '.', [classes] with ranges and '^' negation,
+// \d \w \s \D \W \S, \t \n \r \f \v \e \xHH, escaped metacharacters, (groups),
+// (?:groups), '|', and the quantifiers * + ? {n} {n,} {n,m}. A leading '^'
+// and a trailing '$' anchor a pattern to the start/end of a line.
+//
+// Matching is leftmost-longest; among equally long matches the pattern added
+// first wins.
+class RegexSet {
+public:
+    static constexpr size_t NPOS = static_cast<size_t>(-1);
+
+    // Add a pattern; its index (0, 1, ...) is reported by matches
+    bool add(std::string_view pattern, std::string& error);
+
+    size_t size() const { return rules_.size(); }
+
+    class Matcher;
+
+private:
+    using ByteSet = std::bitset<256>;
+
+    // Parsed pattern
+    struct Node {
+        enum Kind { SET, CONCAT, ALT, REPEAT, EMPTY } kind = EMPTY;
+        int set = -1;          // SET: index into sets_
+        int min = 0, max = 0;  // REPEAT: max < 0 means unbounded
+        std::vector<Node> children;
+    };
+
+    struct NfaState {
+        enum Kind : uint8_t { SET, SPLIT, MATCH } kind;
+        int set  = -1; // SET: byte set to consume
+        int out  = -1; // SET, SPLIT: next state
+        int out1 = -1; // SPLIT: alternative next state
+        int rule = -1; // MATCH
+        bool eol = false;
+    };
+
+    struct Rule {
+        int start;
+        bool bol; // pattern began with '^'
+    };
+
+    static constexpr int MAX_REPEAT = 1000;
+
+    std::vector<ByteSet> sets_;
+    std::vector<NfaState> nfa_;
+    std::vector<Rule> rules_;
+
+    // Parsing
+    struct Parser;
+
+    // Compilation
+    int add_state(NfaState state) {
+        nfa_.push_back(state);
+        return static_cast<int>(nfa_.size() - 1);
+    }
+    int compile(const Node& node, int next);
+};
+
+// Matches a RegexSet, building DFA states as the input needs them. The
+// states belong to the matcher, not the set, so a set can be shared by
+// threads that each have their own matcher. The set must outlive the
+// matcher and get no more patterns while it exists.
+//
+// search() is one forward pass: threads of every pattern start at each
+// offset, and a DFA state keeps them in groups ordered by start offset. A
+// thread that reaches an NFA state an earlier group already holds is dropped,
+// as the earlier start would win any match it makes. Each step only copies the
+// start offsets of the surviving groups. The text after a match may have to
+// be read again (for the starts whose threads were dropped), so patterns like
+// `a+b|a` can still take quadratic time on a long run of 'a'.
+class RegexSet::Matcher {
+public:
+    explicit Matcher(const RegexSet& set);
+
+    // Leftmost-longest non-empty match at or after `from`. `line_start` says
+    // whether offset 0 is at the beginning of a line; `eol` is the offset
+    // where '$' may match (NPOS for nowhere).
+    bool search(std::string_view text, size_t from, bool line_start, size_t eol,
+                size_t& begin, size_t& end, int& rule);
+
+    // Whether any pattern matches `text`; stops at the first match found
+    bool contains(std::string_view text, bool line_start, size_t eol);
+
+private:
+    struct Edge {
+        int state = UNKNOWN;
+        std::vector<int> from; // per group of `state`: source group, or NEW
+    };
+
+    struct DfaState {
+        std::vector<int> nfa;      // groups of sorted NFA states (SET and MATCH), each ended by -1
+        int accept_group     = -1; // first group matching here, ignoring '$' rules...
+        int accept           = -1; // ...and its best rule
+        int accept_eol_group = -1; // same at a line end
+        int accept_eol       = -1;
+        int live_group       = -1; // first group that can still consume input
+        std::vector<Edge> next;
+    };
+
+    static constexpr int UNKNOWN       = -2;
+    static constexpr int DEAD          = -1;
+    static constexpr int NEW           = -1; // group of threads started after the step
+    static constexpr size_t MAX_STATES = 4096; // cache is flushed beyond this
+
+    const RegexSet& set_;
+    std::vector<uint16_t> byte_class_;
+    size_t num_classes_ = 0;
+    ByteSet first_bytes_; // bytes a match can begin with
+    std::vector<DfaState> dfa_;
+    std::map<std::vector<int>, int> dfa_index_;
+    int start_[2]     = {UNKNOWN, UNKNOWN}; // [line_start]
+    uint64_t flushes_ = 0;                  // bumped when the cache is dropped
+    std::vector<int> flushed_from_;         // edge of the last step if it was not cached
+    std::vector<uint32_t> mark_;
+    uint32_t generation_ = 0;
+    std::vector<size_t> starts_, next_starts_; // start offset per group of the current state
+
+    void new_generation();
+    void add_group(std::vector<int>& roots, bool keep_match, std::vector<int>& groups);
+    void add_starts(bool line_start, std::vector<int>& groups);
+    int intern(std::vector<int>&& groups);
+    int start_state(bool line_start);
+    int step(int state, uint8_t byte, const std::vector<int>*& from);
+};
+
+// Implementation
+
+struct RegexSet::Parser {
+    RegexSet& re;
+    std::string_view p;
+    size_t pos = 0;
+    std::string error;
+
+    bool done() const { return pos >= p.size(); }
+    char peek() const { return p[pos]; }
+
+    bool fail(const std::string& message) {
+        if (error.empty()) error = message + " at offset " + std::to_string(pos);
+        return false;
+    }
+
+    int add_set(const ByteSet& set) {
+        re.sets_.push_back(set);
+        return static_cast<int>(re.sets_.size() - 1);
+    }
+
+    Node set_node(const ByteSet& set) {
+        Node node;
+        node.kind = Node::SET;
+        node.set  = add_set(set);
+        return node;
+    }
+
+    static ByteSet range(unsigned char lo, unsigned char hi) {
+        ByteSet set;
+        for (unsigned c = lo; c <= hi; ++c) set.set(c);
+        return set;
+    }
+
+    static int hex_digit(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    static ByteSet single(unsigned char c) {
+        ByteSet set;
+        set.set(c);
+        return set;
+    }
+
+    // \d \w \s
+    static ByteSet shorthand(char c) {
+        if (c == 'd') return range('0', '9');
+        if (c == 'w') return range('a', 'z') | range('A', 'Z') | range('0', '9') | single('_');
+        return range('\t', '\r') | single(' ');
+    }
+
+    // Escape after '\'; fills `set`
+    bool parse_escape(ByteSet& set) {
+        if (done()) return fail("trailing backslash");
+        char c = p[pos++];
+        switch (c) {
+        case 'd': case 'w': case 's': set = shorthand(c);                return true;
+        case 'D': case 'W': case 'S': set = ~shorthand(c - 'A' + 'a');   return true;
+        case 't': set = single('\t'); return true;
+        case 'n': set = single('\n'); return true;
+        case 'r': set = single('\r'); return true;
+        case 'f': set = single('\f'); return true;
+        case 'v': set = single('\v'); return true;
+        case 'e': set = single(0x1b); return true;
+        case 'x': {
+            int hi = pos + 2 <= p.size() ? hex_digit(p[pos]) : -1;
+            int lo = pos + 2 <= p.size() ? hex_digit(p[pos + 1]) : -1;
+            if (hi < 0 || lo < 0) return fail("expected two hex digits after \\x");
+            pos += 2;
+            set = single(static_cast<unsigned char>(hi * 16 + lo));
+            return true;
+        }
+        default:
+            if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')) {
+                --pos;
+                return fail(std::string("unknown escape \\") + c);
+            }
+            set = single(static_cast<unsigned char>(c));
+            return true;
+        }
+    }
+
+    bool parse_class(ByteSet& set) {
+        set.reset();
+        bool negate = !done() && peek() == '^';
+        if (negate) ++pos;
+
+        bool first = true;
+        while (!done() && (peek() != ']' || first)) {
+            first = false;
+            ByteSet item;
+            unsigned char lo = static_cast<unsigned char>(peek());
+            if (peek() == '\\') {
+                ++pos;
+                if (!parse_escape(item)) return false;
+                if (item.count() != 1) {
+                    set |= item;
+                    continue;
+                }
+                for (unsigned c = 0; c < 256; ++c) {
+                    if (item[c]) lo = static_cast<unsigned char>(c);
+                }
+            } else {
+                ++pos;
+            }
+
+            if (pos + 1 < p.size() && peek() == '-' && p[pos + 1] != ']') {
+                ++pos;
+                unsigned char hi = static_cast<unsigned char>(peek());
+                if (peek() == '\\') {
+                    ++pos;
+                    ByteSet end;
+                    if (!parse_escape(end)) return false;
+                    if (end.count() != 1) return fail("invalid range end");
+                    for (unsigned c = 0; c < 256; ++c) {
+                        if (end[c]) hi = static_cast<unsigned char>(c);
+                    }
+                } else {
+                    ++pos;
+                }
+                if (hi < lo) return fail("reversed range");
+                set |= range(lo, hi);
+            } else {
+                set.set(lo);
+            }
+        }
+        if (done()) return fail("unterminated [");
+        ++pos; // ']'
+        if (negate) set = ~set;
+        return true;
+    }
+
+    bool parse_number(int& value) {
+        size_t begin = pos;
+        value = 0;
+        while (!done() && peek() >= '0' && peek() <= '9') {
+            value = value * 10 + (peek() - '0');
+            if (value > MAX_REPEAT) return fail("repeat count too large");
+            ++pos;
+        }
+        return pos > begin;
+    }
+
+    bool parse_atom(Node& node) {
+        char c = p[pos++];
+        switch (c) {
+        case '(':
+            if (p.substr(pos, 2) == "?:") pos += 2;
+            if (!parse_alt(node)) return false;
+            if (done() || peek() != ')') return fail("missing )");
+            ++pos;
+            return true;
+        case '[': {
+            ByteSet set;
+            if (!parse_class(set)) return false;
+            node = set_node(set);
+            return true;
+        }
+        case '.':
+            node = set_node(~single('\n'));
+            return true;
+        case '\\': {
+            ByteSet set;
+            if (!parse_escape(set)) return false;
+            node = set_node(set);
+            return true;
+        }
+        case '*': case '+': case '?': case '{':
+            --pos;
+            return fail("nothing to repeat");
+        case '^': case '$':
+            --pos;
+            return fail("anchors are only supported at the start/end of a pattern");
+        default:
+            node = set_node(single(static_cast<unsigned char>(c)));
+            return true;
+        }
+    }
+
+    bool parse_repeat(Node& node) {
+        if (!parse_atom(node)) return false;
+        while (!done()) {
+            int min, max;
+            char c = peek();
+            if (c == '*') {
+                min = 0, max = -1;
+            } else if (c == '+') {
+                min = 1, max = -1;
+            } else if (c == '?') {
+                min = 0, max = 1;
+            } else if (c == '{') {
+                ++pos;
+                if (!parse_number(min)) return fail("expected repeat count");
+                max = min;
+                if (!done() && peek() == ',') {
+                    ++pos;
+                    if (!parse_number(max)) max = -1;
+                }
+                if (!error.empty()) return false;
+                if (done() || peek() != '}') return fail("expected }");
+                if (max >= 0 && max < min) return fail("invalid repeat range");
+            } else {
+                break;
+            }
+            ++pos;
+
+            Node repeat;
+            repeat.kind = Node::REPEAT;
+            repeat.min  = min;
+            repeat.max  = max;
+            repeat.children.push_back(std::move(node));
+            node = std::move(repeat);
+        }
+        return true;
+    }
+
+    bool parse_concat(Node& node) {
+        node.kind = Node::CONCAT;
+        while (!done() && peek() != '|' && peek() != ')') {
+            // Trailing '$' is handled by the caller
+            if (peek() == '$' && pos + 1 == p.size()) break;
+            Node child;
+            if (!parse_repeat(child)) return false;
+            node.children.push_back(std::move(child));
+        }
+        return true;
+    }
+
+    bool parse_alt(Node& node) {
+        Node first;
+        if (!parse_concat(first)) return false;
+        if (done() || peek() != '|') {
+            node = std::move(first);
+            return true;
+        }
+        node = Node{};
+        node.kind = Node::ALT;
+        node.children.push_back(std::move(first));
+        while (!done() && peek() == '|') {
+            ++pos;
+            Node next;
+            if (!parse_concat(next)) return false;
+            node.children.push_back(std::move(next));
+        }
+        return true;
+    }
+};
+
+inline int RegexSet::compile(const Node& node, int next) {
+    switch (node.kind) {
+    case Node::SET:
+        return add_state({NfaState::SET, node.set, next});
+    case Node::CONCAT:
+        for (auto it = node.children.rbegin(); it != node.children.rend(); ++it) {
+            next = compile(*it, next);
+        }
+        return next;
+    case Node::ALT: {
+        int cur = compile(node.children.back(), next);
+        for (size_t i = node.children.size() - 1; i-- > 0;) {
+            int branch = compile(node.children[i], next);
+            cur        = add_state({NfaState::SPLIT, -1, branch, cur});
+        }
+        return cur;
+    }
+    case Node::REPEAT: {
+        const Node& child = node.children[0];
+        int cur = next;
+        if (node.max < 0) {
+            int loop       = add_state({NfaState::SPLIT, -1, -1, next});
+            nfa_[loop].out = compile(child, loop);
+            cur            = loop;
+        } else {
+            for (int i = node.min; i < node.max; ++i) {
+                int branch = compile(child, cur);
+                cur        = add_state({NfaState::SPLIT, -1, branch, next});
+            }
+        }
+        for (int i = 0; i < node.min; ++i) {
+            cur = compile(child, cur);
+        }
+        return cur;
+    }
+    case Node::EMPTY:
+    default:
+        return next;
+    }
+}
+
+inline bool RegexSet::add(std::string_view pattern, std::string& error) {
+    bool bol = !pattern.empty() && pattern[0] == '^';
+    if (bol) pattern.remove_prefix(1);
+
+    // A trailing unescaped '$' anchors to the line end
+    size_t backslashes = 0;
+    for (size_t i = pattern.size(); i-- > 1 && pattern[i - 1] == '\\';) ++backslashes;
+    bool eol = !pattern.empty() && pattern.back() == '$' && backslashes % 2 == 0;
+
+    if (pattern.empty() || pattern == "$") {
+        error = "empty pattern";
+        return false;
+    }
+
+    size_t sets_before = sets_.size();
+    Parser parser{*this, pattern, 0, {}};
+    Node root;
+    if (!parser.parse_alt(root) || (!parser.done() && !(eol && parser.pos + 1 == pattern.size()))) {
+        if (parser.error.empty()) parser.fail("unexpected )");
+        error = parser.error;
+        sets_.resize(sets_before);
+        return false;
+    }
+
+    NfaState match{NfaState::MATCH};
+    match.rule = static_cast<int>(rules_.size());
+    match.eol  = eol;
+    int start  = compile(root, add_state(match));
+    rules_.push_back({start, bol});
+    return true;
+}
+
+inline RegexSet::Matcher::Matcher(const RegexSet& set) : set_(set) {
+    // Byte classes: bytes that no set tells apart share a DFA column
+    std::map<std::vector<bool>, uint16_t> classes;
+    byte_class_.assign(256, 0);
+    for (unsigned b = 0; b < 256; ++b) {
+        std::vector<bool> signature(set_.sets_.size());
+        for (size_t s = 0; s < set_.sets_.size(); ++s) signature[s] = set_.sets_[s][b];
+        auto [it, inserted] = classes.emplace(std::move(signature), static_cast<uint16_t>(classes.size()));
+        byte_class_[b] = it->second;
+    }
+    num_classes_ = classes.size();
+    mark_.assign(set_.nfa_.size(), 0);
+
+    if (start_state(true) == DEAD) return;
+    for (int s : dfa_[start_state(true)].nfa) {
+        if (s >= 0 && set_.nfa_[s].kind == NfaState::SET) first_bytes_ |= set_.sets_[set_.nfa_[s].set];
+    }
+}
+
+inline void RegexSet::Matcher::new_generation() {
+    if (++generation_ == 0) {
+        std::fill(mark_.begin(), mark_.end(), 0);
+        generation_ = 1;
+    }
+}
+
+// Append the states reachable from `roots` without consuming input as a group,
+// leaving out states an earlier group of this generation has
+inline void RegexSet::Matcher::add_group(std::vector<int>& roots, bool keep_match, std::vector<int>& groups) {
+    size_t first = groups.size();
+    while (!roots.empty()) {
+        int s = roots.back();
+        roots.pop_back();
+        if (s < 0 || mark_[s] == generation_) continue;
+        mark_[s] = generation_;
+        const NfaState& n = set_.nfa_[s];
+        if (n.kind == NfaState::SPLIT) {
+            roots.push_back(n.out1);
+            roots.push_back(n.out);
+        } else if (n.kind == NfaState::SET || keep_match) {
+            groups.push_back(s);
+        }
+    }
+    if (groups.size() == first) return;
+    std::sort(groups.begin() + first, groups.end());
+    groups.push_back(-1);
+}
+
+// Threads starting at the current offset. They have matched nothing, so their
+// MATCH states (empty matches) are left out.
+inline void RegexSet::Matcher::add_starts(bool line_start, std::vector<int>& groups) {
+    std::vector<int> roots;
+    for (const Rule& rule : set_.rules_) {
+        if (line_start || !rule.bol) roots.push_back(rule.start);
+    }
+    add_group(roots, false, groups);
+}
+
+inline int RegexSet::Matcher::intern(std::vector<int>&& groups) {
+    if (groups.empty()) return DEAD;
+    auto it = dfa_index_.find(groups);
+    if (it != dfa_index_.end()) return it->second;
+
+    if (dfa_.size() >= MAX_STATES) {
+        // Drop the cache; callers only hold on to the id returned below
+        dfa_.clear();
+        dfa_index_.clear();
+        start_[0] = start_[1] = UNKNOWN;
+        ++flushes_;
+    }
+
+    DfaState state;
+    int group = 0;
+    for (int s : groups) {
+        if (s < 0) {
+            ++group;
+            continue;
+        }
+        const NfaState& n = set_.nfa_[s];
+        if (n.kind == NfaState::SET) {
+            if (state.live_group < 0) state.live_group = group;
+            continue;
+        }
+        if (state.accept_eol_group < 0 || (state.accept_eol_group == group && n.rule < state.accept_eol)) {
+            state.accept_eol_group = group;
+            state.accept_eol       = n.rule;
+        }
+        if (!n.eol && (state.accept_group < 0 || (state.accept_group == group && n.rule < state.accept))) {
+            state.accept_group = group;
+            state.accept       = n.rule;
+        }
+    }
+    state.next.resize(num_classes_);
+    state.nfa = groups;
+
+    int id = static_cast<int>(dfa_.size());
+    dfa_.push_back(std::move(state));
+    dfa_index_.emplace(std::move(groups), id);
+    return id;
+}
+
+inline int RegexSet::Matcher::start_state(bool line_start) {
+    if (start_[line_start] == UNKNOWN) {
+        std::vector<int> groups;
+        new_generation();
+        add_starts(line_start, groups);
+        int id = intern(std::move(groups));
+        start_[line_start] = id; // assigned after intern(), which may reset start_
+    }
+    return start_[line_start];
+}
+
+inline int RegexSet::Matcher::step(int state, uint8_t byte, const std::vector<int>*& from) {
+    uint16_t cls = byte_class_[byte];
+    const Edge& edge = dfa_[state].next[cls];
+    if (edge.state != UNKNOWN) {
+        from = &edge.from;
+        return edge.state;
+    }
+
+    // Advance each group in order, then start new threads after the byte
+    new_generation();
+    std::vector<int> groups, sources, roots;
+    int group = 0;
+    for (int s : dfa_[state].nfa) {
+        if (s >= 0) {
+            const NfaState& n = set_.nfa_[s];
+            if (n.kind == NfaState::SET && set_.sets_[n.set][byte]) roots.push_back(n.out);
+            continue;
+        }
+        size_t size = groups.size();
+        add_group(roots, true, groups);
+        if (groups.size() != size) sources.push_back(group);
+        ++group;
+    }
+    size_t size = groups.size();
+    add_starts(false, groups);
+    if (groups.size() != size) sources.push_back(NEW);
+
+    uint64_t flushes = flushes_;
+    int next = intern(std::move(groups));
+    if (flushes == flushes_) {
+        Edge& cached = dfa_[state].next[cls]; // `state` is gone if the cache was dropped
+        cached.state = next;
+        cached.from  = std::move(sources);
+        from         = &cached.from;
+    } else {
+        flushed_from_ = std::move(sources);
+        from          = &flushed_from_;
+    }
+    return next;
+}
+
+inline bool RegexSet::Matcher::search(std::string_view text, size_t from, bool line_start, size_t eol,
+                                      size_t& begin, size_t& end, int& rule) {
+    if (set_.rules_.empty() || from >= text.size()) return false;
+
+    // Best match so far; final once no group that started at or before it
+    // can still consume input
+    size_t best_begin = NPOS;
+    size_t best_end   = NPOS;
+    int best_rule     = -1;
+
+    bool bol   = line_start && from == 0;
+    int state  = start_state(bol);
+    bool fresh = !bol; // the state holds only threads started at the offset
+    if (state == DEAD) return false;
+    starts_.assign(1, from);
+    for (size_t i = from; i < text.size(); ++i) {
+        if (fresh && best_begin == NPOS && !first_bytes_[static_cast<uint8_t>(text[i])]) {
+            // Only fresh threads, which the byte would kill: skip to where a
+            // match can begin
+            while (i < text.size() && !first_bytes_[static_cast<uint8_t>(text[i])]) ++i;
+            if (i == text.size()) break;
+            starts_[0] = i;
+        }
+
+        const std::vector<int>* sources;
+        state = step(state, static_cast<uint8_t>(text[i]), sources);
+        if (state == DEAD) break;
+        next_starts_.resize(sources->size());
+        for (size_t g = 0; g < sources->size(); ++g) {
+            int source      = (*sources)[g];
+            next_starts_[g] = source == NEW ? i + 1 : starts_[source];
+        }
+        starts_.swap(next_starts_);
+        fresh = sources->size() == 1 && sources->front() == NEW;
+
+        const DfaState& current = dfa_[state];
+        bool at_eol = i + 1 == eol;
+        int group   = at_eol ? current.accept_eol_group : current.accept_group;
+        if (group >= 0 && starts_[group] <= best_begin) {
+            // An earlier start, or a longer match from the same one
+            best_begin = starts_[group];
+            best_end   = i + 1;
+            best_rule  = at_eol ? current.accept_eol : current.accept;
+        }
+        if (best_begin != NPOS && (current.live_group < 0 || starts_[current.live_group] > best_begin)) break;
+    }
+
+    if (best_begin == NPOS) return false;
+    begin = best_begin;
+    end   = best_end;
+    rule  = best_rule;
+    return true;
+}
+
+inline bool RegexSet::Matcher::contains(std::string_view text, bool line_start, size_t eol) {
+    if (set_.rules_.empty()) return false;
+
+    int state  = start_state(line_start);
+    bool fresh = !line_start;
+    for (size_t i = 0; state != DEAD && i < text.size(); ++i) {
+        if (fresh && !first_bytes_[static_cast<uint8_t>(text[i])]) continue; // stays fresh
+
+        const std::vector<int>* sources;
+        state = step(state, static_cast<uint8_t>(text[i]), sources);
+        if (state == DEAD) break;
+        fresh = sources->size() == 1 && sources->front() == NEW;
+
+        const DfaState& current = dfa_[state];
+        if ((i + 1 == eol ? current.accept_eol_group : current.accept_group) >= 0) return true;
+    }
+    return false;
+}
@@ -0,0 +1,83 @@
+// signals.h - Finish output in order on fatal signals
+#pragma once
+
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+
+namespace signals {
+
+namespace detail {
+
+// The handlers do not touch any output: a signal can arrive in the middle of
+// a write(2) or while a buffer is being shifted, and whatever a handler wrote
+// from it could repeat or tear output. The main loop polls pending() instead,
+// finishes the output as at the end of input, then calls raise_pending().
+inline volatile sig_atomic_t pending = 0;
+
+inline void on_terminate(int sig) {
+    if (pending) {
+        // Second signal: output is stuck (e.g. a stopped terminal), give up on it
+        std::signal(sig, SIG_DFL);
+        std::raise(sig);
+        return;
+    }
+    pending = sig;
+}
+
+inline void on_broken_pipe(int) {
+    // The reader is gone; nothing left to flush, nothing worth reporting
+    _exit(EXIT_SUCCESS);
+}
+
+} // namespace detail
+
+// Install handlers for SIGINT/SIGTERM (note the signal for pending()) and
+// SIGPIPE (exit quietly). Without SA_RESTART, a blocking call returns EINTR
+// so the signal is noticed promptly; wait for input with wait_readable().
+inline void install() {
+    struct sigaction sa {};
+    sigemptyset(&sa.sa_mask);
+    sa.sa_handler = detail::on_terminate;
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+
+    sa.sa_handler = detail::on_broken_pipe;
+    sigaction(SIGPIPE, &sa, nullptr);
+}
+
+// SIGINT or SIGTERM received and not yet acted on, or 0
+inline int pending() { return detail::pending; }
+
+// Wait until read(2) on `fd` would not block. False if a SIGINT or SIGTERM
+// is pending instead: the signals stay blocked from the check of pending()
+// until ppoll() unblocks them, so one arriving in between still ends the
+// wait rather than being noticed only after the next input.
+inline bool wait_readable(int fd) {
+    sigset_t terminate, old;
+    sigemptyset(&terminate);
+    sigaddset(&terminate, SIGINT);
+    sigaddset(&terminate, SIGTERM);
+    sigprocmask(SIG_BLOCK, &terminate, &old);
+    bool ready = false;
+    if (!detail::pending) {
+        pollfd pfd{fd, POLLIN, 0};
+        ready = ppoll(&pfd, 1, nullptr, &old) >= 0 || errno != EINTR; // errors: read() reports them
+    }
+    sigprocmask(SIG_SETMASK, &old, nullptr);
+    return ready;
+}
+
+// Once output is finished: die of the pending signal, so the parent still
+// sees death-by-signal (exit status 130 or 143 in a shell)
+inline void raise_pending() {
+    if (int sig = detail::pending) {
+        std::signal(sig, SIG_DFL);
+        std::raise(sig);
+    }
+}
+
+} // namespace signals
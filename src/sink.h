@@ -0,0 +1,116 @@
+// sink.h - Output destinations for rendered text
+#pragma once
+
+#include <cstdio>
+#include <span>
+#include <string>
+#include <string_view>
+
+// Receives everything FormatterAutomaton renders (text and ANSI escapes)
+class Sink {
+public:
+    virtual ~Sink() = default;
+
+    virtual void write(std::string_view text) = 0;
+    virtual void put(char c) { write(std::string_view(&c, 1)); }
+
+    // Push out anything held back (end of input or explicit flush point)
+    virtual void flush() {}
+
+    // For producers that generate output in place (a compressor): room for
+    // at least `min` bytes in the sink's own buffer, then commit() of the
+    // bytes filled. An empty span means there is no buffer to lend; use
+    // write() then.
+    virtual std::span<char> reserve(size_t /*min*/) { return {}; }
+    virtual void commit(size_t /*len*/) {}
+};
+
+// Writes to a stdio stream (stdout by default)
+class StdioSink : public Sink {
+public:
+    explicit StdioSink(FILE* stream) : stream_(stream) {}
+
+    void write(std::string_view text) override {
+        std::fwrite(text.data(), 1, text.size(), stream_);
+    }
+
+    void put(char c) override { std::putc(c, stream_); }
+    void flush() override { std::fflush(stream_); }
+
+    static StdioSink& standard_output() {
+        static StdioSink sink(stdout);
+        return sink;
+    }
+
+private:
+    FILE* stream_;
+};
+
+// Appends to a caller-owned string
+class StringSink : public Sink {
+public:
+    explicit StringSink(std::string& out) : out_(out) {}
+
+    void write(std::string_view text) override { out_ += text; }
+    void put(char c) override { out_ += c; }
+
+private:
+    std::string& out_;
+};
+
+// Drops everything, for work whose output does not matter (profiling)
+class DiscardSink : public Sink {
+public:
+    void write(std::string_view) override {}
+    void put(char) override {}
+};
+
+// Forwards to another sink, counting the bytes that pass through
+class CountingSink : public Sink {
+public:
+    explicit CountingSink(Sink& out) : out_(out) {}
+
+    void write(std::string_view text) override {
+        bytes_ += text.size();
+        out_.write(text);
+    }
+
+    void put(char c) override {
+        ++bytes_;
+        out_.put(c);
+    }
+
+    void flush() override { out_.flush(); }
+
+    std::span<char> reserve(size_t min) override { return out_.reserve(min); }
+
+    void commit(size_t len) override {
+        bytes_ += len;
+        out_.commit(len);
+    }
+
+    size_t bytes() const { return bytes_; }
+
+private:
+    Sink& out_;
+    size_t bytes_ = 0;
+};
+
+// Copies into an output iterator (e.g. std::back_inserter or fmt::appender)
+template <typename OutputIt>
+class IteratorSink : public Sink {
+public:
+    explicit IteratorSink(OutputIt out) : out_(out) {}
+
+    void write(std::string_view text) override {
+        for (char c : text) *out_++ = c;
+    }
+
+    void put(char c) override { *out_++ = c; }
+
+    // Position past the last written character
+    OutputIt out() const { return out_; }
+
+private:
+    OutputIt out_;
+};
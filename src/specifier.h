@@ -0,0 +1,87 @@
+// specifier.h - Parser for format specifiers such as "*r" or ";B_"
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+#include "alphabet.h"
+#include "format.h"
+#include "syntax.h"
+
+// Incremental specifier parser: feed characters one at a time, as the
+// automaton does inside a tag, then read the resulting format mask.
+// Characters are looked up in an alphabet, which must outlive the parser.
+class SpecifierParser {
+public:
+    explicit SpecifierParser(const SpecifierAlphabet& alphabet = SpecifierAlphabet::standard())
+        : alphabet_(&alphabet) {}
+
+    // Try to consume one specifier character; false if it is invalid here
+    bool accept(int c);
+
+    const Format& format() const { return format_; }
+
+    void reset() {
+        format_        = Format::empty();
+        parsed_colors_ = 0;
+        parsed_styles_ = 0;
+    }
+
+    // Parse a whole specifier, e.g. from a config file
+    static std::optional<Format> parse(std::string_view spec,
+                                       const SpecifierAlphabet& alphabet = SpecifierAlphabet::standard()) {
+        SpecifierParser parser(alphabet);
+        for (char c : spec) {
+            if (!parser.accept(static_cast<unsigned char>(c))) return std::nullopt;
+        }
+        return parser.format();
+    }
+
+private:
+    const SpecifierAlphabet* alphabet_;
+    Format format_          = Format::empty();
+    int parsed_colors_      = 0;
+    uint16_t parsed_styles_ = 0;
+
+    bool parse_color(Color color, bool bright);
+    bool parse_style(uint16_t style_bit);
+};
+
+// Implementation
+
+inline bool SpecifierParser::accept(int c) {
+    const SpecifierAlphabet::Action& action = (*alphabet_)[static_cast<uint8_t>(c)];
+    switch (action.kind) {
+    case SpecifierAlphabet::Action::COLOR:
+        return parse_color(static_cast<Color>(action.value & 15), action.value & 16);
+    case SpecifierAlphabet::Action::STYLE:
+        return parse_style(static_cast<uint16_t>(1u << action.value));
+    case SpecifierAlphabet::Action::RESET:
+        format_.reset = 1;
+        return true;
+    default:
+        return false;
+    }
+}
+
+inline bool SpecifierParser::parse_color(Color color, bool bright) {
+    if (parsed_colors_ >= 2) return false;
+
+    if (parsed_colors_ == 0) {
+        format_.set_fg(color, bright);
+    } else {
+        format_.set_bg(color, bright);
+    }
+    parsed_colors_++;
+    return true;
+}
+
+inline bool SpecifierParser::parse_style(uint16_t style_bit) {
+    // Duplicate style in same bracket is invalid
+    if (parsed_styles_ & style_bit) return false;
+
+    parsed_styles_ |= style_bit;
+    format_.set_style_bits(format_.style_bits() | style_bit);
+    return true;
+}
@@ -0,0 +1,240 @@
+// styled_format.h - std::format / {fmt} integration that renders tags while formatting
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <iterator>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <version>
+
+#include "automaton.h"
+#include "sink.h"
+#include "tag_syntax.h"
+
+#ifdef __cpp_lib_format
+#include <format>
+#endif
+
+// Formatted arguments are rendered as plain text: tags in user data (a
+// "{r--" in a logged file name) do not take effect. Wrap an argument in
+// styled_markup() to have its tags rendered too.
+template <typename T>
+struct StyledMarkup {
+    // How the argument is held: by reference, C strings as pointers
+    std::conditional_t<std::is_array_v<T>, const std::remove_extent_t<T>*, const T&> value;
+};
+
+template <typename T>
+StyledMarkup<T> styled_markup(const T& value) { return {value}; }
+
+namespace styled_detail {
+
+template <typename T>
+inline constexpr bool is_markup = false;
+
+template <typename T>
+inline constexpr bool is_markup<StyledMarkup<T>> = true;
+
+// Per argument of a format call whether it is markup; one extra entry so
+// that a call without arguments has an array too
+template <typename... Args>
+inline constexpr bool MARKUP[] = {is_markup<std::remove_cvref_t<Args>>..., false};
+
+// Call literal(text) for the format string's own text ("{{" and "}}" already
+// unescaped) and field(replacement, argument) for each replacement field, in
+// order. Automatic argument ids in the field are made explicit, so it formats
+// the same on its own; `argument` is its id, or -1 for a named argument.
+// The format string has been checked by the format library.
+template <typename LiteralFn, typename FieldFn>
+void split_fields(std::string_view format, LiteralFn&& literal, FieldFn&& field) {
+    std::string replacement;
+    size_t next_id = 0;
+
+    // Copy the argument id at format[i] (or the next automatic one) to
+    // `replacement`; returns it, or -1 for a name
+    auto copy_id = [&](size_t& i) {
+        size_t end = format.find_first_of(":}", i);
+        std::string_view id = format.substr(i, end - i);
+        i = end;
+        if (id.empty()) {
+            replacement += std::to_string(next_id);
+            return static_cast<long>(next_id++);
+        }
+        replacement += id;
+        return id[0] >= '0' && id[0] <= '9' ? std::stol(std::string(id)) : -1L;
+    };
+
+    size_t start = 0;
+    for (size_t i = 0; i < format.size(); ++i) {
+        char c = format[i];
+        if (c != '{' && c != '}') continue;
+        if (i + 1 < format.size() && format[i + 1] == c) { // "{{" or "}}"
+            literal(format.substr(start, i + 1 - start));
+            start = ++i + 1;
+            continue;
+        }
+        literal(format.substr(start, i - start));
+
+        replacement = "{";
+        ++i;
+        long argument = copy_id(i);
+        // The spec, with the ids of nested fields (dynamic width or
+        // precision) made explicit as well
+        while (i < format.size() && format[i] != '}') {
+            char s = format[i++];
+            replacement += s;
+            if (s == '{') {
+                copy_id(i);
+                replacement += format[i++]; // its '}'
+            }
+        }
+        replacement += '}';
+        field(std::string_view(replacement), argument);
+        start = i + 1;
+    }
+    literal(format.substr(start));
+}
+
+} // namespace styled_detail
+
+// Feeds what a StyledIterator writes to an automaton, as markup or as text
+class StyledTarget {
+public:
+    explicit StyledTarget(FormatterAutomaton& automaton) : automaton_(automaton) {}
+
+    // What is written from now on is rendered as markup, or as text
+    void begin(bool markup) {
+        flush();
+        markup_ = markup;
+    }
+
+    void put(char c) {
+        if (size_ == buffer_.size()) flush();
+        buffer_[size_++] = c;
+    }
+
+    void flush() {
+        std::string_view written(buffer_.data(), size_);
+        size_ = 0;
+        if (written.empty()) return;
+        if (markup_) {
+            automaton_.accept(written);
+        } else {
+            automaton_.accept_text(written);
+        }
+    }
+
+private:
+    FormatterAutomaton& automaton_;
+    bool markup_ = true;
+    std::array<char, 256> buffer_; // written, not yet fed
+    size_t size_ = 0;
+};
+
+// Output iterator that feeds every character written to it to a StyledTarget.
+// Copies share the target, so it can be handed to format_to() by value.
+class StyledIterator {
+public:
+    using iterator_category = std::output_iterator_tag;
+    using value_type        = void;
+    using difference_type   = std::ptrdiff_t;
+    using pointer           = void;
+    using reference         = void;
+
+    StyledIterator() = default;
+    explicit StyledIterator(StyledTarget& target) : target_(&target) {}
+
+    StyledIterator& operator=(char c) {
+        target_->put(c);
+        return *this;
+    }
+
+    StyledIterator& operator*() { return *this; }
+    StyledIterator& operator++() { return *this; }
+    StyledIterator& operator++(int) { return *this; }
+
+private:
+    StyledTarget* target_ = nullptr;
+};
+
+// Render `format_str` and write the result straight into `out`: its own text
+// as markup, each replacement field as text, or as markup if its argument is
+// flagged in `markup`. This is the library-agnostic core; `format_field` is
+// expected to call format_to(StyledIterator, field, <all arguments>).
+//
+// Replacement fields use braces, so pick a TagSyntax without '{' (e.g. BRACKET).
+template <typename OutputIt, typename FormatFieldFn>
+OutputIt render_styled(OutputIt out, const TagSyntax& syntax, std::string_view format_str,
+                       std::span<const bool> markup, FormatFieldFn&& format_field) {
+    IteratorSink<OutputIt> sink(out);
+    FormatterAutomaton automaton(false, false, true, syntax, sink);
+    StyledTarget target(automaton);
+    styled_detail::split_fields(
+        format_str, [&](std::string_view text) { automaton.accept(text); },
+        [&](std::string_view field, long argument) {
+            target.begin(argument >= 0 && static_cast<size_t>(argument) < markup.size() && markup[argument]);
+            format_field(StyledIterator(target), field);
+            target.flush();
+        });
+    automaton.finish();
+    return sink.out();
+}
+
+#ifdef __cpp_lib_format
+
+template <typename T, typename Char>
+struct std::formatter<StyledMarkup<T>, Char> : std::formatter<std::remove_cvref_t<decltype(StyledMarkup<T>::value)>, Char> {
+    template <typename FormatContext>
+    auto format(const StyledMarkup<T>& arg, FormatContext& ctx) const {
+        return std::formatter<std::remove_cvref_t<decltype(arg.value)>, Char>::format(arg.value, ctx);
+    }
+};
+
+// styled_format_to(out, TagSyntax::BRACKET, "[r]{}[/]", x)
+template <typename OutputIt, typename... Args>
+OutputIt styled_format_to(OutputIt out, const TagSyntax& syntax,
+                          std::format_string<Args...> format_str, Args&&... args) {
+    auto store = std::make_format_args(args...);
+    return render_styled(out, syntax, format_str.get(), styled_detail::MARKUP<Args...>,
+                         [&](StyledIterator it, std::string_view field) {
+                             std::vformat_to(it, field, std::format_args(store));
+                         });
+}
+
+template <typename... Args>
+std::string styled_format(const TagSyntax& syntax, std::format_string<Args...> format_str, Args&&... args) {
+    std::string result;
+    styled_format_to(std::back_inserter(result), syntax, format_str, std::forward<Args>(args)...);
+    return result;
+}
+
+#endif // __cpp_lib_format
+
+#ifdef FMT_VERSION
+
+// Same as above for {fmt}; include <fmt/format.h> before this header.
+// Works with fmt::memory_buffer via fmt::appender.
+template <typename T>
+struct fmt::formatter<StyledMarkup<T>, char> : fmt::formatter<std::remove_cvref_t<decltype(StyledMarkup<T>::value)>, char> {
+    template <typename FormatContext>
+    auto format(const StyledMarkup<T>& arg, FormatContext& ctx) const {
+        return fmt::formatter<std::remove_cvref_t<decltype(arg.value)>, char>::format(arg.value, ctx);
+    }
+};
+
+template <typename OutputIt, typename... Args>
+OutputIt styled_fmt_format_to(OutputIt out, const TagSyntax& syntax,
+                              fmt::format_string<Args...> format_str, Args&&... args) {
+    auto store = fmt::make_format_args(args...);
+    fmt::string_view format(format_str);
+    return render_styled(out, syntax, std::string_view(format.data(), format.size()), styled_detail::MARKUP<Args...>,
+                         [&](StyledIterator it, std::string_view field) {
+                             fmt::vformat_to(it, fmt::string_view(field), fmt::format_args(store));
+                         });
+}
+
+#endif // FMT_VERSION
@@ -0,0 +1,132 @@
+// syntax_set.h - Several tag syntaxes recognised in a single pass
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "tag_syntax.h"
+
+// The tag syntaxes an automaton accepts, compiled for its default state:
+// a table of the syntaxes whose open tag starts with each byte, and one
+// Aho–Corasick DFA over all close tags. Checking a byte costs the same
+// whether one syntax is active or many.
+class SyntaxSet {
+public:
+    static constexpr size_t MAX_SYNTAXES = 32;
+    static constexpr int32_t ROOT        = 0;
+
+    SyntaxSet() = default;
+
+    // Implicit, so a single syntax can be passed wherever a set is expected
+    SyntaxSet(const TagSyntax& syntax) { add(syntax); }
+
+    // Syntaxes must outlive the set. Returns false when the set is full;
+    // adding a syntax twice has no effect.
+    bool add(const TagSyntax& syntax);
+
+    size_t size() const { return syntaxes_.size(); }
+    bool empty() const { return syntaxes_.empty(); }
+    const TagSyntax& operator[](size_t i) const { return *syntaxes_[i]; }
+
+    // Bit i is set if the open tag of syntax i starts with `c`
+    uint32_t open_starting_with(uint8_t c) const { return open_start_[c]; }
+
+    // `c` occurs in no close tag and starts no open tag: outside of tags
+    // it is plain text
+    bool plain(uint8_t c) const { return !byte_class_[c] && !open_start_[c]; }
+
+    // Close tag matcher: feed bytes from ROOT; a state other than ROOT means
+    // the text read so far ends with the beginning of some close tag
+    int32_t step(int32_t state, uint8_t c) const {
+        return next_[static_cast<size_t>(state) * num_classes_ + byte_class_[c]];
+    }
+
+    // Syntax with the longest close tag ending in `state`, or -1
+    int closed_at(int32_t state) const { return closed_[state]; }
+
+private:
+    std::vector<const TagSyntax*> syntaxes_;
+    std::array<uint32_t, 256> open_start_{};
+
+    std::array<uint16_t, 256> byte_class_{}; // bytes in no close tag share class 0
+    size_t num_classes_ = 1;
+    std::vector<int32_t> next_ = std::vector<int32_t>(1, ROOT); // complete transition table
+    std::vector<int8_t> closed_ = std::vector<int8_t>(1, -1);
+
+    void build();
+};
+
+// Implementation
+
+inline bool SyntaxSet::add(const TagSyntax& syntax) {
+    for (const TagSyntax* s : syntaxes_) {
+        if (s == &syntax) return true;
+    }
+    if (syntaxes_.size() >= MAX_SYNTAXES) return false;
+
+    auto bit = uint32_t{1} << syntaxes_.size();
+    syntaxes_.push_back(&syntax);
+    if (!syntax.open_tag.empty()) {
+        open_start_[static_cast<uint8_t>(syntax.open_tag[0])] |= bit;
+    }
+    build();
+    return true;
+}
+
+inline void SyntaxSet::build() {
+    byte_class_.fill(0);
+    num_classes_ = 1;
+    for (const TagSyntax* s : syntaxes_) {
+        for (unsigned char c : s->close_tag) {
+            if (!byte_class_[c]) byte_class_[c] = static_cast<uint16_t>(num_classes_++);
+        }
+    }
+
+    // Trie of close tags; -1 marks a missing edge until failure links fill it
+    next_.assign(num_classes_, -1);
+    closed_.assign(1, -1);
+    for (size_t k = 0; k < syntaxes_.size(); ++k) {
+        int32_t state = ROOT;
+        for (unsigned char c : syntaxes_[k]->close_tag) {
+            int32_t& edge = next_[static_cast<size_t>(state) * num_classes_ + byte_class_[c]];
+            if (edge < 0) {
+                edge = static_cast<int32_t>(closed_.size());
+                next_.resize(next_.size() + num_classes_, -1);
+                closed_.push_back(-1);
+            }
+            state = next_[static_cast<size_t>(state) * num_classes_ + byte_class_[c]];
+        }
+        if (state != ROOT && closed_[state] < 0) closed_[state] = static_cast<int8_t>(k);
+    }
+
+    // Failure links (BFS), folded into the table; a state without a close
+    // tag of its own inherits the longest one ending in its suffix
+    std::vector<int32_t> fail(closed_.size(), ROOT);
+    std::vector<int32_t> queue;
+    for (size_t cls = 0; cls < num_classes_; ++cls) {
+        if (next_[cls] < 0) {
+            next_[cls] = ROOT;
+        } else {
+            queue.push_back(next_[cls]);
+        }
+    }
+    for (size_t head = 0; head < queue.size(); ++head) {
+        int32_t state  = queue[head];
+        int32_t suffix = fail[state];
+        if (closed_[state] < 0) closed_[state] = closed_[suffix];
+
+        for (size_t cls = 0; cls < num_classes_; ++cls) {
+            int32_t& target  = next_[static_cast<size_t>(state) * num_classes_ + cls];
+            int32_t via_fail = next_[static_cast<size_t>(suffix) * num_classes_ + cls];
+            if (target < 0) {
+                target = via_fail;
+            } else {
+                fail[target] = via_fail;
+                queue.push_back(target);
+            }
+        }
+    }
+}
@@ -0,0 +1,142 @@
+// table.h - Align separator-delimited columns of rendered text
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "sink.h"
+#include "unicode.h"
+
+// Sink decorator that lays out separator-delimited lines as a table, like
+// `column -t -s SEP`, but measuring cells by display width (escape sequences
+// take no space) and holding at most `window` rows at a time.
+//
+// Rows are emitted whenever the window fills. Column widths only grow, so a
+// column widened by a later window stays aligned with the following ones.
+class TableSink : public Sink {
+public:
+    static constexpr size_t DEFAULT_WINDOW = 1000;
+    static constexpr std::string_view GAP = "  "; // between columns
+
+    TableSink(Sink& out, std::string_view separator, size_t window = DEFAULT_WINDOW)
+        : out_(out), separator_(separator), window_(window ? window : 1) {
+        unicode::WidthCounter counter;
+        counter.write(separator);
+        separator_width_ = counter.width();
+    }
+
+    void write(std::string_view text) override {
+        for (char c : text) put(c);
+    }
+
+    void put(char c) override {
+        bool escape = c == '\e' || counter_.in_escape();
+        if (c == '\n' && !escape) {
+            end_row(true);
+            return;
+        }
+
+        row().text += c;
+        counter_.put(c);
+        plain_ = escape ? 0 : plain_ + 1;
+
+        // A separator inside an escape sequence (e.g. ';') does not count
+        if (plain_ >= separator_.size() && row().text.size() >= separator_.size() &&
+            std::string_view(row().text).substr(row().text.size() - separator_.size()) == separator_) {
+            row().text.resize(row().text.size() - separator_.size());
+            end_cell(counter_.width() - separator_width_);
+            plain_ = 0;
+        }
+    }
+
+    void flush() override {
+        if (!row().text.empty() || !row().cells.empty()) end_row(false);
+        emit();
+        out_.flush();
+    }
+
+private:
+    struct Cell {
+        size_t end;   // offset in Row::text
+        size_t width; // display columns
+    };
+
+    struct Row {
+        std::string text;
+        std::vector<Cell> cells;
+        bool newline = false;
+    };
+
+    Sink& out_;
+    const std::string separator_;
+    const size_t window_;
+    size_t separator_width_;
+
+    std::vector<Row> rows_; // rows_[0, used_) are complete, rows_[used_] is in progress
+    size_t used_ = 0;
+    std::vector<size_t> widths_; // per column, grows only
+
+    unicode::WidthCounter counter_; // columns since the start of the row
+    size_t cell_start_ = 0;         // counter_ value where the current cell began
+    size_t plain_      = 0;         // trailing bytes of the row outside escapes
+
+    Row& row() {
+        if (rows_.size() <= used_) rows_.resize(used_ + 1);
+        return rows_[used_];
+    }
+
+    void end_cell(size_t row_width) {
+        row().cells.push_back({row().text.size(), row_width - cell_start_});
+        cell_start_ = counter_.width();
+    }
+
+    void end_row(bool newline) {
+        end_cell(counter_.final_width());
+        Row& r    = row();
+        r.newline = newline;
+
+        // The last cell is not padded, so it does not widen its column
+        if (widths_.size() < r.cells.size() - 1) widths_.resize(r.cells.size() - 1);
+        for (size_t col = 0; col + 1 < r.cells.size(); ++col) {
+            widths_[col] = std::max(widths_[col], r.cells[col].width);
+        }
+
+        ++used_;
+        counter_.reset();
+        cell_start_ = 0;
+        plain_      = 0;
+        if (used_ >= window_) emit();
+    }
+
+    // Write the complete rows and recycle their storage
+    void emit() {
+        static constexpr char SPACES[] = "                                ";
+        for (size_t i = 0; i < used_; ++i) {
+            Row& r       = rows_[i];
+            size_t begin = 0;
+            for (size_t col = 0; col < r.cells.size(); ++col) {
+                const Cell& cell = r.cells[col];
+                out_.write(std::string_view(r.text).substr(begin, cell.end - begin));
+                begin = cell.end;
+                if (col + 1 == r.cells.size()) break;
+
+                for (size_t pad = widths_[col] - cell.width; pad;) {
+                    size_t n = std::min(pad, sizeof(SPACES) - 1);
+                    out_.write(std::string_view(SPACES, n));
+                    pad -= n;
+                }
+                out_.write(GAP);
+            }
+            if (r.newline) out_.put('\n');
+            r.text.clear();
+            r.cells.clear();
+        }
+
+        // Keep the row in progress at the front
+        if (used_ < rows_.size()) std::swap(rows_[0], rows_[used_]);
+        used_ = 0;
+    }
+};
@@ -24,10 +24,82 @@ Options:
     -v --version            print version string
     -l --legend             show formatting legend
     -s --strip              strip formatting tags from input
-    -e --escape             enable C-like escape sequences (\a\b\r\n\f\t\v\#)
+    -e --escape             enable C-like escape sequences (\n, \xHH, \#, ...)
     -S --no-sanitize        do not insert format reset on EOF
-    -x --syntax=STYLE       use alternative tag syntax (see below)
+    -x --syntax=STYLE[,STYLE...]  use alternative tag syntax (see below)
     -c --custom OPEN SEP CLOSE   define custom tag syntax (see below)
+       --flush=POLICY       when to write output: auto, line, full, none,
+                            sync (auto = line on a terminal, full otherwise;
+                            sync = once per read of input, large batches as
+                            one synchronized terminal update)
+       --collapse-cr[=FPS]  collapse '\r' progress updates: keep only the final
+                            state of each line, or on a terminal redraw at
+                            most FPS times per second (default 30) and
+                            whenever input pauses
+       --highlight-file=FILE  format every occurrence of the keywords listed
+                            in FILE, one 'KEYWORD SPECIFIER' per line
+                            (e.g. 'ERROR *R'), as if they were tagged
+       --rules=FILE         like --highlight-file, with 'REGEX SPECIFIER' lines
+                            (e.g. '\d+ms$ y'); keywords win over overlapping
+                            rules, earlier rules over later ones
+       --grep=REGEX         output only lines whose text (without tags)
+                            matches REGEX; may be repeated to match any of
+                            several patterns
+       --max-rate=N[/s]     pass at most N input lines per second (bursts of
+                            up to one second's worth); the others are
+                            dropped unrendered and reported as 'K lines
+                            suppressed' before the next line let through
+       --dedupe             fold runs of identical input lines into
+                            'last line repeated K times'
+       --width              print the display width of each line (or of
+                            each argument) instead of the text: tags and
+                            escapes take no space, wide characters two
+       --cut=COLS           truncate each line to COLS columns; tags after
+                            the cut still take effect, so formatting stays
+                            balanced
+       --ellipsis[=STR]     with --cut, end truncated lines with STR
+                            (default '…')
+       --table=SEP          align SEP-separated columns like 'column -t',
+                            measuring visible width; rows are written in
+                            batches of 1000, so input of any length streams
+       --optimize-ansi      rewrite SGR escapes (ours and those in the input)
+                            into the fewest needed for the same output
+       --palette=FILE       render colors as remapped in FILE, one
+                            '[fg:|bg:]COLOR VALUE' per line; COLOR is a
+                            color specifier (k..w, K..W, d, or as remapped
+                            by --alphabet), VALUE another one, a 256-color
+                            index or #RRGGBB
+                            (e.g. 'r #ff5f5f', 'bg:d 236'); the reset at
+                            the end of output restores the terminal's own
+                            defaults
+       --alphabet=FILE      use other specifier characters, one 'NAME CHAR'
+                            per line (e.g. 'bold +', 'bright-red !'); names:
+                            black..white, bright-black..bright-white,
+                            default, current, reversed, blink, bold, italic,
+                            underline, overline, double-underline,
+                            strikethrough, dim, reset. Also applies to
+                            the specifiers in --highlight-file, --rules
+                            and --palette files, wherever it is given
+       --compress=FORMAT    compress the output in-process: gzip or zstd
+                            (if built with zlib / libzstd)
+       --emit-header=FILE   compile a catalog of 'ID = tagged text' lines
+                            into a C header on stdout: ID_ANSI and ID_PLAIN
+                            string literals (as the CLI would print them,
+                            honouring -e, -x, -c, -S) and ID_WIDTH
+       --progress           report progress on stderr once a second: input
+                            so far, MB/s, tags/s, time spent waiting for
+                            input (a slow source), and for a file on stdin
+                            the percentage done and ETA
+       --profile-input      print a profile of the input instead of the
+                            text: size, line lengths, tag density, nesting
+                            depths, specifiers and escapes, no content
+       --generate-input=FILE  print input synthesized from a profile, as
+                            much as the profiled input (for benchmarks), in
+                            the syntax of -x or -c as profiles do not
+                            record it
+       --stats              report input/output size, time and hardware
+                            counters (cycles, instructions, branch and
+                            cache misses per input byte) on stderr
        --demo               show demo
     -h --help               display this help and exit
 
@@ -39,6 +111,10 @@ Syntax styles (--syntax):
     The bracket and xml styles provide more familiar syntax for users coming
     from other markup languages. The xml style is similar to HTML/XML tags.
 
+    Several styles can be combined ('--syntax=classic,xml', repeated -x or
+    -c options) to render mixed input in one pass. Any close tag closes the
+    innermost open tag, whatever its style.
+
 Custom syntax (-c):
     Define your own tag syntax with 3 arguments: OPEN SEP CLOSE
     
@@ -75,6 +151,9 @@ Overview:
 
 Escape sequences (-e mode):
     Standard C escapes: \\ \a \b \r \n \f \t \v
+    Escape character:   \e
+    Numeric escapes:    \xHH (1-2 hex digits), \NNN (1-3 octal digits),
+                        \uXXXX (1-4 hex digits, written as UTF-8)
     Whitespace trim:    \# (greedily consumes following whitespace)
 
     The \# escape provides bounded-memory whitespace trimming. It consumes
@@ -117,8 +196,16 @@ Remarks:
     - Use non-standard styles (blink, overline, double underline,
       strikethrough) with care; terminal support varies.
     - Programs in pipelines use system-default buffering, which may cause
-      interactive output to appear frozen. Tools like 'stdbuf' or 'unbuffer'
-      can help.
+      interactive output to appear frozen. Use '--flush=line' (or 'none') for
+      output; for input, tools like 'stdbuf -i0' or 'unbuffer' can help.
+    - Terminals that lag painting large redirected inputs keep up better
+      with '--flush=sync': each batch is wrapped in DEC mode 2026 sequences
+      on a terminal and drawn at once.
+    - Output to non-blocking descriptors is retried with poll() on EAGAIN,
+      so nothing is lost when stdout is shared with an event loop.
+    - SIGINT/SIGTERM end the input: output is finished as at its end (the
+      format is reset) before exiting, and a second signal exits at once; a
+      closed pipe (SIGPIPE) ends the formatter quietly.
     - The primary use case is piping and printf-style debugging; argument-based
       usage exists for convenience. Always quote arguments containing spaces.
 )-";
@@ -145,6 +232,7 @@ inline const char* LEGEND = R"-(
 ┃ ┏━[Escapes (-e mode)]━━━━━━━━━━━━━━━━━━━━━━┓ ┃
 ┃ ┃  \# Trim following whitespace (greedy)   ┃ ┃
 ┃ ┃  \\ \a \b \r \n \f \t \v (C escapes)     ┃ ┃
+┃ ┃  \e \xHH \uXXXX \NNN (ESC, hex, octal)   ┃ ┃
 ┃ ┗━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━┛ ┃
 ┃ ┏━[Control]━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━┓ ┃
 ┃1┃  1st encountered color is fg, 2nd is bg  ┃ ┃
@@ -160,7 +248,7 @@ inline const char* LEGEND = R"-(
 ┃ ┃   - doesn't crash on invalid format      ┃ ┃
 ┃2┃  Terminals may lack support for some ops ┃ ┃
 ┃ ┃  Buffering may break interactiveness     ┃ ┃
-┃ ┃   - `stdbuf -i0 -o0 formatter` may help  ┃ ┃
+┃ ┃   - `--flush=line` or `stdbuf -i0` help  ┃ ┃
 ┃ ┗━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━┛ ┃
 ┗━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━┛
 )-";
@@ -0,0 +1,173 @@
+// unicode.h - Display width of UTF-8 text in a terminal
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string_view>
+
+namespace unicode {
+
+struct Range {
+    char32_t first;
+    char32_t last;
+};
+
+// Combining marks and other zero-width code points
+inline constexpr Range ZERO_WIDTH[] = {
+    {0x00AD, 0x00AD},   {0x0300, 0x036F},   {0x0483, 0x0489},   {0x0591, 0x05BD},
+    {0x05BF, 0x05BF},   {0x05C1, 0x05C2},   {0x05C4, 0x05C5},   {0x05C7, 0x05C7},
+    {0x0610, 0x061A},   {0x064B, 0x065F},   {0x0670, 0x0670},   {0x06D6, 0x06DC},
+    {0x06DF, 0x06E4},   {0x06E7, 0x06E8},   {0x06EA, 0x06ED},   {0x0711, 0x0711},
+    {0x0730, 0x074A},   {0x07A6, 0x07B0},   {0x0900, 0x0902},   {0x093A, 0x093A},
+    {0x093C, 0x093C},   {0x0941, 0x0948},   {0x094D, 0x094D},   {0x0951, 0x0957},
+    {0x0962, 0x0963},   {0x0E31, 0x0E31},   {0x0E34, 0x0E3A},   {0x0E47, 0x0E4E},
+    {0x1160, 0x11FF},   {0x1AB0, 0x1AFF},   {0x1DC0, 0x1DFF},   {0x200B, 0x200F},
+    {0x202A, 0x202E},   {0x2060, 0x2064},   {0x20D0, 0x20FF},   {0x302A, 0x302D},
+    {0x3099, 0x309A},   {0xFE00, 0xFE0F},   {0xFE20, 0xFE2F},   {0xFEFF, 0xFEFF},
+    {0x1F3FB, 0x1F3FF}, {0xE0000, 0xE007F}, {0xE0100, 0xE01EF},
+};
+
+// East Asian Wide/Fullwidth and emoji presentation code points
+inline constexpr Range WIDE[] = {
+    {0x1100, 0x115F},   {0x231A, 0x231B},   {0x2329, 0x232A},   {0x23E9, 0x23EC},
+    {0x23F0, 0x23F0},   {0x23F3, 0x23F3},   {0x25FD, 0x25FE},   {0x2614, 0x2615},
+    {0x2648, 0x2653},   {0x267F, 0x267F},   {0x2693, 0x2693},   {0x26A1, 0x26A1},
+    {0x26AA, 0x26AB},   {0x26BD, 0x26BE},   {0x26C4, 0x26C5},   {0x26CE, 0x26CE},
+    {0x26D4, 0x26D4},   {0x26EA, 0x26EA},   {0x26F2, 0x26F3},   {0x26F5, 0x26F5},
+    {0x26FA, 0x26FA},   {0x26FD, 0x26FD},   {0x2705, 0x2705},   {0x270A, 0x270B},
+    {0x2728, 0x2728},   {0x274C, 0x274C},   {0x274E, 0x274E},   {0x2753, 0x2755},
+    {0x2757, 0x2757},   {0x2795, 0x2797},   {0x27B0, 0x27B0},   {0x27BF, 0x27BF},
+    {0x2B1B, 0x2B1C},   {0x2B50, 0x2B50},   {0x2B55, 0x2B55},   {0x2E80, 0x303E},
+    {0x3041, 0x33FF},   {0x3400, 0x4DBF},   {0x4E00, 0x9FFF},   {0xA000, 0xA4CF},
+    {0xA960, 0xA97F},   {0xAC00, 0xD7A3},   {0xF900, 0xFAFF},   {0xFE10, 0xFE19},
+    {0xFE30, 0xFE6F},   {0xFF00, 0xFF60},   {0xFFE0, 0xFFE6},   {0x16FE0, 0x16FE4},
+    {0x17000, 0x18CFF}, {0x1B000, 0x1B2FF}, {0x1F004, 0x1F004}, {0x1F0CF, 0x1F0CF},
+    {0x1F18E, 0x1F18E}, {0x1F191, 0x1F19A}, {0x1F200, 0x1F202}, {0x1F210, 0x1F23B},
+    {0x1F240, 0x1F248}, {0x1F250, 0x1F251}, {0x1F260, 0x1F265}, {0x1F300, 0x1F320},
+    {0x1F32D, 0x1F335}, {0x1F337, 0x1F37C}, {0x1F37E, 0x1F393}, {0x1F3A0, 0x1F3CA},
+    {0x1F3CF, 0x1F3D3}, {0x1F3E0, 0x1F3F0}, {0x1F3F4, 0x1F3F4}, {0x1F3F8, 0x1F3FA},
+    {0x1F400, 0x1F43E}, {0x1F440, 0x1F440}, {0x1F442, 0x1F4FC}, {0x1F4FF, 0x1F53D},
+    {0x1F54B, 0x1F54E}, {0x1F550, 0x1F567}, {0x1F57A, 0x1F57A}, {0x1F595, 0x1F596},
+    {0x1F5A4, 0x1F5A4}, {0x1F5FB, 0x1F64F}, {0x1F680, 0x1F6C5}, {0x1F6CC, 0x1F6CC},
+    {0x1F6D0, 0x1F6D2}, {0x1F6D5, 0x1F6D7}, {0x1F6DC, 0x1F6DF}, {0x1F6EB, 0x1F6EC},
+    {0x1F6F4, 0x1F6FC}, {0x1F7E0, 0x1F7EB}, {0x1F7F0, 0x1F7F0}, {0x1F90C, 0x1F93A},
+    {0x1F93C, 0x1F945}, {0x1F947, 0x1F9FF}, {0x1FA70, 0x1FAFF}, {0x20000, 0x2FFFD},
+    {0x30000, 0x3FFFD},
+};
+
+template <size_t N>
+constexpr bool in_table(char32_t cp, const Range (&table)[N]) {
+    if (cp < table[0].first || cp > table[N - 1].last) return false;
+    auto it = std::upper_bound(std::begin(table), std::end(table), cp,
+                               [](char32_t value, const Range& r) { return value < r.first; });
+    return it != std::begin(table) && cp <= std::prev(it)->last;
+}
+
+// Columns a code point occupies: 0 (controls, combining marks), 1 or 2
+constexpr int char_width(char32_t cp) {
+    if (cp >= 0x20 && cp < 0x7F) return 1;
+    if (cp < 0xA0) return 0; // C0, DEL, C1
+    if (in_table(cp, ZERO_WIDTH)) return 0;
+    if (in_table(cp, WIDE)) return 2;
+    return 1;
+}
+
+// Counts the columns of UTF-8 text fed in pieces of any size (split
+// characters and escape sequences are fine). Escape sequences and control
+// characters take no space, except tabs, which advance to the next multiple
+// of 8 columns; each malformed byte takes one column, as the terminal shows a
+// replacement character for it.
+class WidthCounter {
+public:
+    // Columns added by this byte: the width of a character is reported with
+    // its last byte
+    int put(char c) {
+        auto b = static_cast<uint8_t>(c);
+
+        if (escape_ != Escape::NONE) {
+            if (escape_ == Escape::ESC && b == '[') {
+                escape_ = Escape::CSI;
+            } else if (escape_ == Escape::ESC || (b >= 0x40 && b <= 0x7E)) {
+                escape_ = Escape::NONE;
+            }
+            return 0;
+        }
+
+        int width = 0;
+        if (pending_) {
+            if ((b & 0xC0) == 0x80) {
+                cp_ = (cp_ << 6) | (b & 0x3F);
+                if (--pending_) return 0;
+                return add(char_width(cp_));
+            }
+            pending_ = 0;
+            width    = 1; // truncated sequence, then reprocess b
+        }
+
+        if (b < 0x80) {
+            if (b == 0x1B) {
+                escape_ = Escape::ESC;
+            } else if (b == '\t') {
+                width += static_cast<int>(TAB_WIDTH - (width_ + static_cast<size_t>(width)) % TAB_WIDTH);
+            } else if (b >= 0x20 && b != 0x7F) {
+                ++width;
+            }
+        } else if (b >= 0xC2 && b <= 0xDF) {
+            cp_      = b & 0x1F;
+            pending_ = 1;
+        } else if (b >= 0xE0 && b <= 0xEF) {
+            cp_      = b & 0x0F;
+            pending_ = 2;
+        } else if (b >= 0xF0 && b <= 0xF4) {
+            cp_      = b & 0x07;
+            pending_ = 3;
+        } else {
+            ++width; // stray continuation or invalid lead byte
+        }
+        return add(width);
+    }
+
+    // Same as put() per byte; runs of printable ASCII are counted at once
+    void write(std::string_view text) {
+        size_t i = 0;
+        while (i < text.size()) {
+            if (!in_sequence()) {
+                size_t run = i;
+                while (run < text.size() && static_cast<uint8_t>(text[run]) - 0x20u < 0x5Fu) ++run;
+                width_ += run - i;
+                i = run;
+                if (i == text.size()) break;
+            }
+            put(text[i++]);
+        }
+    }
+
+    size_t width() const { return width_; }
+
+    // Inside a multi-byte character or an escape sequence
+    bool in_sequence() const { return pending_ || escape_ != Escape::NONE; }
+    bool in_escape() const { return escape_ != Escape::NONE; }
+
+    // A character split at the end of input counts as one malformed byte
+    size_t final_width() const { return width_ + (pending_ ? 1 : 0); }
+
+    void reset() { *this = WidthCounter(); }
+
+private:
+    enum class Escape : uint8_t { NONE, ESC, CSI };
+    static constexpr size_t TAB_WIDTH = 8;
+
+    size_t width_  = 0;
+    char32_t cp_   = 0;
+    int pending_   = 0; // continuation bytes still expected
+    Escape escape_ = Escape::NONE;
+
+    int add(int width) {
+        width_ += static_cast<size_t>(width);
+        return width;
+    }
+};
+
+} // namespace unicode
@@ -0,0 +1,107 @@
+// width.h - Display width of tagged text
+#pragma once
+
+#include <charconv>
+#include <cstddef>
+#include <optional>
+#include <string_view>
+
+#include "automaton.h"
+#include "sink.h"
+#include "tag_syntax.h"
+#include "unicode.h"
+
+// Counts the columns of everything written to it instead of storing it
+class WidthSink : public Sink {
+public:
+    void write(std::string_view text) override { counter_.write(text); }
+    void put(char c) override { counter_.put(c); }
+
+    size_t width() const { return counter_.final_width(); }
+    void reset() { counter_.reset(); }
+
+private:
+    unicode::WidthCounter counter_;
+};
+
+// Display width of `text` once tags are removed, as it would be rendered:
+// UTF-8 aware, wide characters take two columns, escape sequences and
+// control characters none (see unicode::WidthCounter). Runs the rendering
+// automaton in strip mode, which hands the text between tags to the counter
+// in spans and writes no SGR sequences; the automaton is kept per thread
+// with its own copy of the syntax, so calls after the first one with an
+// equal syntax do not allocate.
+inline size_t visible_width(std::string_view text, const TagSyntax& syntax = TagSyntax::CLASSIC,
+                            bool escape = false) {
+    thread_local WidthSink sink;
+    thread_local TagSyntax cached_syntax; // the automaton refers to it
+    thread_local std::optional<FormatterAutomaton> automaton;
+
+    sink.reset();
+    if (automaton && automaton->escape() == escape && cached_syntax.open_tag == syntax.open_tag &&
+        cached_syntax.open_end == syntax.open_end && cached_syntax.close_tag == syntax.close_tag) {
+        automaton->reset();
+    } else {
+        automaton.reset();
+        cached_syntax = syntax;
+        automaton.emplace(true, escape, false, cached_syntax, sink);
+    }
+    automaton->accept(text);
+    automaton->finish();
+    return sink.width();
+}
+
+// Writes the display width of each line it receives (as a decimal number on
+// a line of its own) to another sink; used by `formatter --width`
+class LineWidthSink : public Sink {
+public:
+    explicit LineWidthSink(Sink& out) : out_(out) {}
+
+    void write(std::string_view text) override {
+        while (!text.empty()) {
+            size_t end = text.find('\n');
+            if (end == std::string_view::npos) {
+                counter_.write(text);
+                open_ = true;
+                return;
+            }
+            if (end) {
+                counter_.write(text.substr(0, end));
+                open_ = true;
+            }
+            end_line();
+            text.remove_prefix(end + 1);
+        }
+    }
+
+    void put(char c) override {
+        if (c == '\n') {
+            end_line();
+        } else {
+            counter_.put(c);
+            open_ = true;
+        }
+    }
+
+    // Report the last line, unless the input ended with a newline
+    void flush() override {
+        if (open_ || !reported_) end_line();
+        out_.flush();
+    }
+
+private:
+    Sink& out_;
+    unicode::WidthCounter counter_;
+    bool open_     = false; // current line has received bytes
+    bool reported_ = false; // at least one line was reported
+
+    void end_line() {
+        char digits[24];
+        auto result = std::to_chars(digits, digits + sizeof(digits), counter_.final_width());
+        out_.write(std::string_view(digits, static_cast<size_t>(result.ptr - digits)));
+        out_.put('\n');
+        counter_.reset();
+        open_     = false;
+        reported_ = true;
+    }
+};
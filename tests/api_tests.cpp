@@ -0,0 +1,426 @@
+// api_tests.cpp - Tests of the library API, the headers in src/
+// Usage: make test (builds and runs this after run_tests.sh)
+
+#if __has_include(<fmt/format.h>)
+#define FMT_HEADER_ONLY
+#include <fmt/format.h>
+#endif
+
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <termios.h>
+#include <unistd.h>
+#include <vector>
+
+#include "automaton.h"
+#include "collapse.h"
+#include "cut.h"
+#include "fd_sink.h"
+#include "highlight.h"
+#include "pull.h"
+#include "sink.h"
+#include "styled_format.h"
+#include "syntax_set.h"
+#include "tag_syntax.h"
+#include "width.h"
+
+namespace {
+
+int pass  = 0;
+int fail  = 0;
+int total = 0;
+
+// Escapes shown as ^[ like cat -v does
+std::string visible(std::string_view text) {
+    std::string out;
+    for (char c : text) {
+        if (c == '\033') {
+            out += "^[";
+        } else {
+            out += c;
+        }
+    }
+    return out;
+}
+
+void check(const char* name, std::string_view actual, std::string_view expected) {
+    ++total;
+    if (actual == expected) {
+        std::printf("\033[0;32mPASS\033[0m: %s\n", name);
+        ++pass;
+    } else {
+        std::printf("\033[0;31mFAIL\033[0m: %s\n", name);
+        std::printf("  Expected: %s\n", visible(expected).c_str());
+        std::printf("  Actual:   %s\n", visible(actual).c_str());
+        ++fail;
+    }
+}
+
+void section(const char* title) { std::printf("\n--- %s ---\n", title); }
+
+// What the automaton renders for `input` in one go, the reference for
+// renderers that get it in pieces
+std::string render(std::string_view input, bool escape = false, const TagSyntax& syntax = TagSyntax::CLASSIC) {
+    std::string out;
+    StringSink sink(out);
+    FormatterAutomaton automaton(false, escape, true, syntax, sink);
+    automaton.accept(input);
+    automaton.finish();
+    return out;
+}
+
+// The SGR sequences of the tests' formats
+const std::string RESET    = "\033[0;39;49m";
+const std::string RED      = "\033[0;31;49m";
+const std::string BOLD_RED = "\033[0;1;31;49m";
+
+// =============================================================================
+void styled_format_tests() {
+    section("Styled Format (styled_format.h)");
+
+#ifdef FMT_VERSION
+    std::string out;
+    styled_fmt_format_to(std::back_inserter(out), TagSyntax::BRACKET, "[*r]{}[/]: {}", "error", 42);
+    check("fmt: tags of the format string render", out, RESET + BOLD_RED + "error" + RESET + ": 42" + RESET);
+
+    out.clear();
+    styled_fmt_format_to(std::back_inserter(out), TagSyntax::BRACKET, "[r]{}[/]", "[b]x[/]");
+    check("fmt: tags in arguments stay text", out, RESET + RED + "[b]x[/]" + RESET + RESET);
+
+    out.clear();
+    styled_fmt_format_to(std::back_inserter(out), TagSyntax::BRACKET, "{}{}", "[r", "]a");
+    check("fmt: arguments do not combine into a tag", out, RESET + "[r]a" + RESET);
+
+    out.clear();
+    styled_fmt_format_to(std::back_inserter(out), TagSyntax::BRACKET, "{}: {}", styled_markup("[r]x[/]"), "[/]");
+    check("fmt: styled_markup() arguments render", out, RESET + RED + "x" + RESET + ": [/]" + RESET);
+
+    out.clear();
+    styled_fmt_format_to(std::back_inserter(out), TagSyntax::BRACKET, "[{:>4}|{:x}]", "ab", 255);
+    check("fmt: format specs apply to text arguments", out, RESET + "[  ab|ff]" + RESET);
+
+    out.clear();
+    styled_fmt_format_to(std::back_inserter(out), TagSyntax::BRACKET, "[{:>{}}|{:.{}}]", "ab", 5, "xyz", 2);
+    check("fmt: dynamic width and precision", out, RESET + "[   ab|xy]" + RESET);
+
+    out.clear();
+    styled_fmt_format_to(std::back_inserter(out), TagSyntax::BRACKET, "[r]{1}{{{0}}}[/]", "a", "b");
+    check("fmt: explicit ids and escaped braces", out, RESET + RED + "b{a}" + RESET + RESET);
+
+    out.clear();
+    styled_fmt_format_to(std::back_inserter(out), TagSyntax::BRACKET, "a\x10" "bcdefghijklmnop[r]{}[/]", "x\x10y");
+    check("fmt: DLE bytes are ordinary text", out,
+          RESET + "a\x10" "bcdefghijklmnop" + RED + "x\x10y" + RESET + RESET);
+
+    fmt::memory_buffer buffer;
+    styled_fmt_format_to(fmt::appender(buffer), TagSyntax::BRACKET, "[r]{}[/]", std::string("s"));
+    check("fmt: into a memory_buffer", std::string_view(buffer.data(), buffer.size()),
+          RESET + RED + "s" + RESET + RESET);
+#else
+    std::printf("(no {fmt}: skipped)\n");
+#endif
+
+#ifdef __cpp_lib_format
+    check("std: tags of the format string render", styled_format(TagSyntax::BRACKET, "[*r]{}[/]: {}", "error", 42),
+          RESET + BOLD_RED + "error" + RESET + ": 42" + RESET);
+    check("std: tags in arguments stay text", styled_format(TagSyntax::BRACKET, "[r]{}[/]", "[b]x[/]"),
+          RESET + RED + "[b]x[/]" + RESET + RESET);
+    check("std: styled_markup() arguments render", styled_format(TagSyntax::BRACKET, "{}", styled_markup("[r]x[/]")),
+          RESET + RED + "x" + RESET + RESET);
+    check("std: format specs apply to text arguments", styled_format(TagSyntax::BRACKET, "[{:>4}]", "ab"),
+          RESET + "[  ab]" + RESET);
+    check("std: dynamic width and precision", styled_format(TagSyntax::BRACKET, "[{:>{}}|{:.{}}]", "ab", 5, "xyz", 2),
+          RESET + "[   ab|xy]" + RESET);
+    check("std: DLE bytes are ordinary text", styled_format(TagSyntax::BRACKET, "a\x10" "b[r]{}[/]", "x\x10y"),
+          RESET + "a\x10" "b" + RED + "x\x10y" + RESET + RESET);
+#endif
+}
+
+// =============================================================================
+// Feed `input` to a ChunkRenderer in two parts split at `split`; the chunks,
+// concatenated, or "" if one is larger than `chunk_size`
+std::string render_split(std::string_view input, size_t split, bool escape, size_t chunk_size) {
+    ChunkRenderer renderer(false, escape, true, TagSyntax::CLASSIC, chunk_size);
+    std::string out;
+    auto drain = [&] {
+        while (!renderer.needs_input() && !renderer.done()) {
+            std::string_view chunk = renderer.next();
+            if (chunk.size() > chunk_size) return false;
+            out += chunk;
+        }
+        return true;
+    };
+    renderer.feed(input.substr(0, split));
+    if (!drain()) return "";
+    renderer.feed(input.substr(split));
+    renderer.close();
+    if (!drain()) return "";
+    return out;
+}
+
+// First split point of `input` where the chunked output differs, or -1
+int first_bad_split(std::string_view input, bool escape, size_t chunk_size) {
+    std::string expected = render(input, escape);
+    for (size_t split = 0; split <= input.size(); ++split) {
+        if (render_split(input, split, escape, chunk_size) != expected) return static_cast<int>(split);
+    }
+    return -1;
+}
+
+void pull_tests() {
+    section("Pull Rendering (pull.h)");
+
+    check("chunks: input split inside a tag",
+          std::to_string(first_bad_split("a{*r--bold red--} b{g--c--}", false, 4)), "-1");
+    check("chunks: input split inside escapes",
+          std::to_string(first_bad_split("x\\t\\x41\\u00e9{r--\\#  y--}\\n", true, 3)), "-1");
+    check("chunks: chunk of one byte", std::to_string(first_bad_split("{r--ab--}", false, 1)), "-1");
+    check("chunks: input ends inside a tag", render_split("ab{r-", 3, false, 4), render("ab{r-"));
+    check("chunks: input ends inside a specifier", render_split("ab{r*", 5, false, 2), render("ab{r*"));
+    check("chunks: input ends inside a close tag", render_split("{r--ab-", 4, false, 4), render("{r--ab-"));
+
+    std::string out;
+    bool bounded = true;
+    for (std::string_view chunk : render_chunks("{r--abc--} {b--d", false, false, true, TagSyntax::CLASSIC, 5)) {
+        bounded = bounded && !chunk.empty() && chunk.size() <= 5;
+        out += chunk;
+    }
+    check("generator: chunks render the input", out, render("{r--abc--} {b--d"));
+    check("generator: chunks are non-empty and bounded", bounded ? "yes" : "no", "yes");
+
+    int chunks = 0;
+    for ([[maybe_unused]] std::string_view chunk : render_chunks("", true, false, false)) ++chunks;
+    check("generator: nothing to render", std::to_string(chunks), "0");
+}
+
+// =============================================================================
+void collapse_tests() {
+    section("Carriage-Return Collapsing (collapse.h)");
+
+    std::string out;
+    StringSink sink(out);
+    CollapseSink throttled(sink, true, 1); // one frame per second: the first redraw only
+    throttled.write("100%\r50%");
+    throttled.idle();
+    check("throttled: redraws erase the line, idle() draws the latest frame", out, "100%\r\033[K50%");
+
+    throttled.write("\r7");
+    throttled.idle();
+    check("throttled: a dropped frame still erases what was drawn", out, "100%\r\033[K50%\r\033[K7");
+
+    throttled.write("\r8\n");
+    throttled.flush();
+    check("throttled: the line ends in its final state", out, "100%\r\033[K50%\r\033[K7\r\033[K8\n");
+
+    out.clear();
+    CollapseSink collapsed(sink, false);
+    collapsed.write("10%\r50%");
+    collapsed.idle();
+    check("unthrottled: idle() waits for the line to end", out, "");
+    collapsed.write("\r100%\n");
+    check("unthrottled: only the final segment", out, "100%\n");
+}
+
+// =============================================================================
+void highlight_tests() {
+    section("Highlighters Shared by Automatons (highlight.h)");
+
+    KeywordHighlighter keywords;
+    keywords.add("error", *SpecifierParser::parse("r"));
+    keywords.build();
+    RegexHighlighter rules;
+    std::string why;
+    rules.add("[0-9]+", *SpecifierParser::parse("r*"), why);
+
+    // Two automatons fed byte by byte in turn: neither sees the other's state
+    std::string out_a, out_b;
+    StringSink sink_a(out_a), sink_b(out_b);
+    FormatterAutomaton a(false, false, true, TagSyntax::CLASSIC, sink_a);
+    FormatterAutomaton b(false, false, true, TagSyntax::CLASSIC, sink_b);
+    for (FormatterAutomaton* automaton : {&a, &b}) {
+        automaton->add_highlighter(keywords);
+        automaton->add_highlighter(rules);
+    }
+    std::string_view input_a = "error 42\n", input_b = "7 errors\n";
+    for (size_t i = 0; i < input_a.size() || i < input_b.size(); ++i) {
+        if (i < input_a.size()) a.accept(static_cast<unsigned char>(input_a[i]));
+        if (i < input_b.size()) b.accept(static_cast<unsigned char>(input_b[i]));
+    }
+    a.finish();
+    b.finish();
+    check("shared: first automaton", out_a, RESET + RED + "error" + RESET + " " + BOLD_RED + "42" + RESET + "\n" + RESET);
+    check("shared: second automaton", out_b, RESET + BOLD_RED + "7" + RESET + " " + RED + "error" + RESET + "s\n" + RESET);
+
+    KeywordHighlighter unbuilt;
+    unbuilt.add("error", *SpecifierParser::parse("r"));
+    std::string out;
+    StringSink sink(out);
+    FormatterAutomaton c(false, false, true, TagSyntax::CLASSIC, sink);
+    c.add_highlighter(unbuilt);
+    c.accept("error");
+    c.finish();
+    check("keywords: none found before build()", out, RESET + "error" + RESET);
+
+    // find() on its own scans what it was not handed with scan()
+    KeywordHighlighter overlapping;
+    overlapping.add("err", *SpecifierParser::parse("r"));
+    overlapping.add("error", *SpecifierParser::parse("r"));
+    overlapping.add("or code", *SpecifierParser::parse("r"));
+    overlapping.build();
+    auto scratch = overlapping.make_scratch();
+    std::vector<Match> matches;
+    overlapping.find("an error code, err", true, true, scratch.get(), matches);
+    std::string spans;
+    for (const Match& m : matches) spans += std::to_string(m.begin) + "-" + std::to_string(m.end) + " ";
+    check("keywords: find() without scan(), leftmost-longest", spans, "3-8 15-18 ");
+}
+
+// =============================================================================
+// The whole input rendered, then cut by the sink: what render_cut() must match
+std::string cut_after_render(std::string_view input, size_t columns, std::string_view ellipsis = {}) {
+    std::string out;
+    StringSink sink(out);
+    CutSink cut(sink, columns, ellipsis);
+    {
+        FormatterAutomaton automaton(false, false, true, TagSyntax::CLASSIC, cut);
+        automaton.accept(input);
+    }
+    cut.flush();
+    return out;
+}
+
+void cut_tests() {
+    section("Cutting Lines (cut.h)");
+
+    check("render_cut: text past the budget is dropped, tags still apply", render_cut("ab{r--cdef--}g\nxy{r--z--}", 3),
+          RESET + "ab" + RED + "c" + RESET + "\nxy" + RED + "z" + RESET + RESET);
+    check("render_cut: ellipsis", render_cut("abcdef\nab", 4, "~"), RESET + "abc~\nab" + RESET);
+
+    const char* inputs[] = {
+        "{r--abcdef--}gh\nxy{g--z--}",
+        "abcdefgh{b--ij--}kl\r12345{r--6--}",
+        "{r--ab\ncdefg--}hi\n",
+        "abcd{r\ncdefgh--}ij\nklmnop",   // the line end is part of a failed tag
+        "\xe6\x97\xa5\xe6\x9c\xac\xe8\xaa\x9e{y--xyz--}",
+        "abcdefgh{r--",                   // input ends inside a tag
+        "abcdef\033[1mgh\033[0mij\nk",     // escape sequences in the input pass
+    };
+    for (const char* input : inputs) {
+        for (size_t columns : {1, 3, 5}) {
+            std::string name = "render_cut: same as cutting the whole output, " + std::to_string(columns) +
+                               " columns of " + visible(input);
+            for (char& c : name) {
+                if (c == '\n' || c == '\r') c = ' ';
+            }
+            check(name.c_str(), render_cut(input, columns, "~"), cut_after_render(input, columns, "~"));
+        }
+    }
+}
+
+// =============================================================================
+void syntax_set_tests() {
+    section("Tag Syntax Sets (syntax_set.h)");
+
+    // Between them the close tags use all 256 bytes, one DFA class each
+    std::string low, high;
+    for (int c = 0; c < 128; ++c) low += static_cast<char>(c);
+    for (int c = 128; c < 256; ++c) high += static_cast<char>(c);
+    TagSyntax first("low", "<", ">", low), second("high", "[", "]", high);
+    SyntaxSet syntaxes(first);
+    syntaxes.add(second);
+
+    auto closed_by = [&](std::string_view text) {
+        int32_t state = SyntaxSet::ROOT;
+        for (char c : text) state = syntaxes.step(state, static_cast<uint8_t>(c));
+        return std::to_string(syntaxes.closed_at(state));
+    };
+    check("syntaxes: close tag of the first", closed_by("x" + low), "0");
+    check("syntaxes: close tag of the second", closed_by("x" + high), "1");
+    check("syntaxes: the last byte is not plain", std::to_string(syntaxes.plain(0xff)), "0");
+}
+
+// =============================================================================
+size_t width_in(std::string_view text, std::string_view open, std::string_view sep, std::string_view close) {
+    return visible_width(text, TagSyntax("temporary", open, sep, close)); // gone after the call
+}
+
+void width_tests() {
+    section("Visible Width (width.h)");
+
+    check("width: temporary syntax", std::to_string(width_in("[r]ab[/]", "[", "]", "[/]")), "2");
+    check("width: another temporary syntax", std::to_string(width_in("<r>abc</>", "<", ">", "</>")), "3");
+    check("width: tags of the previous syntax are text", std::to_string(width_in("[r]ab[/]", "<", ">", "</>")),
+          "8");
+    check("width: default syntax", std::to_string(visible_width("{r--abcd--}")), "4");
+    check("width: close tag bytes in text", std::to_string(visible_width("{r--2024-05-13 -}--} a--")), "17");
+}
+
+// =============================================================================
+// What a Flush::SYNC sink with a `capacity`-byte buffer sends to a terminal
+// (a raw pty) for one batch: `text` written in `piece`-byte writes, then
+// flush(). Empty if no pty can be opened.
+std::string sync_batch(size_t capacity, std::string_view text, size_t piece) {
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) < 0 || unlockpt(master) < 0) return {};
+    int slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+    termios raw{};
+    tcgetattr(slave, &raw);
+    cfmakeraw(&raw);
+    tcsetattr(slave, TCSANOW, &raw);
+
+    {
+        FdSink sink(slave, FdSink::Flush::SYNC, capacity);
+        for (size_t i = 0; i < text.size(); i += piece) sink.write(text.substr(i, piece));
+        sink.flush();
+    }
+
+    std::string out;
+    char chunk[4096];
+    fcntl(master, F_SETFL, O_NONBLOCK);
+    for (ssize_t n; (n = read(master, chunk, sizeof(chunk))) > 0;) out.append(chunk, static_cast<size_t>(n));
+    close(slave);
+    close(master);
+    return out;
+}
+
+void fd_sink_tests() {
+    section("Fd Sink (fd_sink.h)");
+
+    std::string batch;
+    for (int i = 0; i < 40; ++i) batch += "line " + std::to_string(i) + " of a batch larger than the buffer\n";
+    std::string update = std::string(FdSink::SYNC_BEGIN) + batch + std::string(FdSink::SYNC_END);
+
+    std::string out = sync_batch(256, batch, 50);
+    if (out.empty()) {
+        std::printf("\033[0;33mSKIP\033[0m: fd sink: sync (no pty)\n");
+        return;
+    }
+    check("fd sink: sync batch overflowing the buffer is one update", out, update);
+    check("fd sink: sync write larger than the buffer is one update", sync_batch(256, batch, 1000), update);
+}
+
+} // namespace
+
+int main() {
+    std::printf("========================================\n");
+    std::printf("Library API Test Suite\n");
+    std::printf("========================================\n");
+
+    styled_format_tests();
+    pull_tests();
+    collapse_tests();
+    highlight_tests();
+    cut_tests();
+    syntax_set_tests();
+    width_tests();
+    fd_sink_tests();
+
+    std::printf("\n========================================\n");
+    std::printf("Results: %d passed, %d failed, %d total\n", pass, fail, total);
+    std::printf("========================================\n");
+    return fail ? 1 : 0;
+}
@@ -69,6 +69,26 @@ run_ansi_test() {
     fi
 }
 
+# Run a test that checks how the formatter ends, not just what it prints
+# Args: test_name actual expected
+check_result() {
+    local name="$1"
+    local actual="$2"
+    local expected="$3"
+
+    TOTAL=$((TOTAL + 1))
+
+    if [[ "$actual" == "$expected" ]]; then
+        echo -e "${GREEN}PASS${NC}: $name"
+        PASS=$((PASS + 1))
+    else
+        echo -e "${RED}FAIL${NC}: $name"
+        echo "  Expected: $expected"
+        echo "  Actual:   $actual"
+        FAIL=$((FAIL + 1))
+    fi
+}
+
 echo "========================================"
 echo "Formatter Test Suite"
 echo "Using: $FORMATTER"
@@ -82,6 +102,28 @@ if [[ ! -x "$FORMATTER" ]]; then
     exit 1
 fi
 
+# Fixture files of the sections below, removed on exit
+HIGHLIGHTS=$(mktemp)
+BAD_HIGHLIGHTS=$(mktemp)
+RULES=$(mktemp)
+BAD_RULES=$(mktemp)
+LONG_RULES=$(mktemp)
+PROGRESS_INPUT=$(mktemp)
+PROFILE=$(mktemp)
+PROFILE_INPUT=$(mktemp)
+CATALOG=$(mktemp)
+BAD_CATALOG=$(mktemp)
+PALETTE=$(mktemp)
+BAD_PALETTE=$(mktemp)
+ALPHABET=$(mktemp)
+ALPHABET_RULES=$(mktemp)
+ALPHABET_PALETTE=$(mktemp)
+BAD_ALPHABET=$(mktemp)
+COMPRESSED=$(mktemp)
+trap 'rm -f "$HIGHLIGHTS" "$BAD_HIGHLIGHTS" "$RULES" "$BAD_RULES" "$LONG_RULES" "$PROGRESS_INPUT" \
+           "$PROFILE" "$PROFILE_INPUT" "$CATALOG" "$BAD_CATALOG" "$PALETTE" "$BAD_PALETTE" \
+           "$ALPHABET" "$ALPHABET_RULES" "$ALPHABET_PALETTE" "$BAD_ALPHABET" "$COMPRESSED"' EXIT
+
 # =============================================================================
 echo "--- Strip Mode Tests (-s) ---"
 # =============================================================================
@@ -151,11 +193,36 @@ run_test "escape: trim multiple spaces" \
     "ab" \
     -se
 
+run_test "escape: trim long run of mixed whitespace" \
+    $'a\\#\n\t\t                        \r\n  \v\f   {r--b--}  c' \
+    "ab  c" \
+    -se
+
 run_test "escape: trim preserves newline after non-ws" \
     "trim\\#   X" \
     "trimX" \
     -se
 
+run_test "escape: hex, octal and ESC" \
+    "\\x41\\102\\0103\\e!" \
+    $'AB\b3\e!' \
+    -se
+
+run_test "escape: unicode written as UTF-8" \
+    "\\u00e9\\u263a." \
+    "é☺." \
+    -se
+
+run_test "escape: numeric escape ends at a non-digit" \
+    "\\x4g\\x\\u" \
+    $'\x04g\\x\\u' \
+    -se
+
+run_test "escape: decoded braces do not open tags" \
+    "\\x7br--a--}" \
+    "{r--a--}" \
+    -se
+
 run_test "escape: invalid escape passed through" \
     "\\q" \
     "\\q" \
@@ -356,6 +423,28 @@ run_test "syntax: invalid name fails" \
 Available: classic, bracket, xml (or use -c for custom)" \
     --syntax=invalid 2>&1 || true
 
+# Several syntaxes at once
+run_test "syntax: classic and xml combined" \
+    "{r--a--} <g>b</> [r]c[/]" \
+    "a b [r]c[/]" \
+    -s --syntax=classic,xml
+
+run_ansi_test "syntax: close tags of any style nest" \
+    "{r--a <g>b</> c--}" \
+    "^[[0;39;49m^[[0;31;49ma ^[[0;32;49mb^[[0;31;49m c^[[0;39;49m^[[0;39;49m" \
+    --syntax=classic,xml
+
+run_test "syntax: repeated -x and -c combine" \
+    "(*r)x) [g]y[/] {b--z--}" \
+    "x y {b--z--}" \
+    -s -c '(' ')' ')' -x bracket
+
+run_test "syntax: invalid name in list fails" \
+    "test" \
+    "Unknown syntax: nope
+Available: classic, bracket, xml (or use -c for custom)" \
+    --syntax=classic,nope
+
 # Custom syntax tests (-c OPEN SEP CLOSE)
 run_test "syntax: custom parentheses" \
     "(*r)bold red)" \
@@ -394,6 +483,552 @@ run_test "syntax: custom multi-char all" \
     "green text" \
     -s -c '@@' '##' '@@'
 
+# =============================================================================
+echo
+echo "--- Output Tests ---"
+# =============================================================================
+
+run_test "output: long option strip" \
+    "{r--red--}" \
+    "red" \
+    --strip
+
+run_test "output: flush none" \
+    "{r--a--}
+{g--b--}" \
+    "a
+b" \
+    -s --flush=none
+
+run_test "output: flush full" \
+    "{r--a--}
+{g--b--}" \
+    "a
+b" \
+    -s --flush=full
+
+run_ansi_test "output: flush line keeps ansi" \
+    "{r--x--}" \
+    "^[[0;39;49m^[[0;31;49mx^[[0;39;49m^[[0;39;49m" \
+    --flush=line
+
+run_ansi_test "output: flush sync off a terminal adds no sequences" \
+    "{r--x--}" \
+    "^[[0;39;49m^[[0;31;49mx^[[0;39;49m^[[0;39;49m" \
+    --flush=sync
+
+run_test "output: invalid flush policy fails" \
+    "test" \
+    "Unknown flush policy: sometimes
+Available: auto, line, full, none, sync" \
+    --flush=sometimes
+
+# =============================================================================
+echo
+echo "--- Progress Line Tests (--collapse-cr) ---"
+# =============================================================================
+
+run_test "collapse: keeps final segment" \
+    $'10%\r50%\r100%\ndone' \
+    $'100%\ndone' \
+    -s --collapse-cr
+
+run_test "collapse: CRLF preserved" \
+    $'a\r\nb\r\n' \
+    $'a\r\nb\r' \
+    -s --collapse-cr
+
+run_ansi_test "collapse: format state carries over" \
+    $'{g--1--}\r{y--2' \
+    "^[[0;39;49m^[[0;33;49m2^[[0;39;49m" \
+    --collapse-cr
+
+run_ansi_test "collapse: off by default" \
+    $'1\r2' \
+    "^[[0;39;49m1^M2^[[0;39;49m"
+
+run_test "collapse: invalid frame rate fails" \
+    "test" \
+    "Invalid frame rate: 0 (expected 1-1000)" \
+    --collapse-cr=0
+
+# =============================================================================
+echo
+echo "--- Highlight Tests (--highlight-file) ---"
+# =============================================================================
+
+printf '# keyword specifier\nERROR *R\nERR r\nWARN y\n' > "$HIGHLIGHTS"
+printf 'ERROR *R\nWARN\n' > "$BAD_HIGHLIGHTS"
+
+run_ansi_test "highlight: keyword wrapped in format" \
+    "an ERROR here" \
+    "^[[0;39;49man ^[[0;1;91;49mERROR^[[0;39;49m here^[[0;39;49m" \
+    --highlight-file="$HIGHLIGHTS"
+
+run_ansi_test "highlight: longest keyword wins" \
+    "ERRERROR" \
+    "^[[0;39;49m^[[0;31;49mERR^[[0;39;49m^[[0;1;91;49mERROR^[[0;39;49m^[[0;39;49m" \
+    --highlight-file="$HIGHLIGHTS"
+
+run_ansi_test "highlight: nests inside tags" \
+    "{g--a WARN b--}" \
+    "^[[0;39;49m^[[0;32;49ma ^[[0;33;49mWARN^[[0;32;49m b^[[0;39;49m^[[0;39;49m" \
+    --highlight-file="$HIGHLIGHTS"
+
+run_test "highlight: tags are not matched" \
+    "{r--x--}ERR{r--OR--}" \
+    "xERROR" \
+    -s --highlight-file="$HIGHLIGHTS"
+
+run_test "highlight: invalid line fails" \
+    "test" \
+    "Invalid highlight file: $BAD_HIGHLIGHTS: line 2: expected 'PATTERN SPECIFIER', got 'WARN'" \
+    --highlight-file="$BAD_HIGHLIGHTS"
+
+run_test "highlight: missing file fails" \
+    "test" \
+    "Cannot open highlight file: /nonexistent/words.txt: No such file or directory" \
+    --highlight-file=/nonexistent/words.txt
+
+# =============================================================================
+echo
+echo "--- Regex Rule Tests (--rules) ---"
+# =============================================================================
+
+printf '^\\[\\w+\\] c\n\\d+ms$ y\nuser-\\d+ *\n(foo|bar)+ g\n' > "$RULES"
+printf 'ok r\n(unclosed r\n' > "$BAD_RULES"
+printf 'a.*z r\n' > "$LONG_RULES"
+
+run_ansi_test "rules: pattern wrapped in format" \
+    "user-42 here" \
+    "^[[0;39;49m^[[0;1;39;49muser-42^[[0;39;49m here^[[0;39;49m" \
+    --rules="$RULES"
+
+run_ansi_test "rules: line anchors" \
+    $'[a] 1ms\nx [b] 2ms later' \
+    $'^[[0;39;49m^[[0;36;49m[a]^[[0;39;49m ^[[0;33;49m1ms^[[0;39;49m\nx [b] 2ms later^[[0;39;49m' \
+    --rules="$RULES"
+
+run_ansi_test "rules: longest match" \
+    "foobarfoo!" \
+    "^[[0;39;49m^[[0;32;49mfoobarfoo^[[0;39;49m!^[[0;39;49m" \
+    --rules="$RULES"
+
+run_ansi_test "rules: keywords take precedence" \
+    "ERROR foo" \
+    "^[[0;39;49m^[[0;1;91;49mERROR^[[0;39;49m ^[[0;32;49mfoo^[[0;39;49m^[[0;39;49m" \
+    --rules="$RULES" --highlight-file="$HIGHLIGHTS"
+
+# Every offset of the long line starts a match attempt that runs to its end;
+# one pass handles them all (runs of 'a' are squeezed for the comparison)
+LONG_LINE="$(printf '%60000s' '' | tr ' ' a)"
+actual=$(echo -n "$LONG_LINE"$'\nxaz' | timeout 5 "$FORMATTER" --rules="$LONG_RULES" 2>&1 | cat -v | tr -s a)
+check_result "rules: long line without a match" "$actual" \
+    $'^[[0;39;49ma\nx^[[0;31;49maz^[[0;39;49m^[[0;39;49m'
+
+run_test "rules: invalid regex fails" \
+    "test" \
+    "Invalid rules file: $BAD_RULES: line 2: missing ) at offset 9" \
+    --rules="$BAD_RULES"
+
+# =============================================================================
+echo
+echo "--- Grep Tests (--grep) ---"
+# =============================================================================
+
+run_test "grep: keeps matching lines" \
+    $'one ERROR\ntwo\nthree WARN\n' \
+    $'one ERROR\nthree WARN' \
+    -s --grep=ERROR --grep=WARN
+
+run_test "grep: matches across tags" \
+    $'{r--ERR--}OR\nok\n' \
+    "ERROR" \
+    -s --grep=ERROR
+
+run_ansi_test "grep: format carries over dropped lines" \
+    $'{g--skip\nkeep--}\nskip\n' \
+    $'^[[0;32;49mkeep^[[0;39;49m\n^[[0;39;49m' \
+    --grep=keep
+
+run_test "grep: anchors apply to visible text" \
+    $'{r--a--}b\nba\n' \
+    "ab" \
+    -s --grep='^ab$'
+
+# Reuses the 60 KB line of the rules tests
+actual=$(echo -n "$LONG_LINE"$'\nxaz\n' | timeout 5 "$FORMATTER" -s --grep='a.*z' 2>&1)
+check_result "grep: long line without a match" "$actual" "xaz"
+
+# The head of the line does not match; the rest must not be judged as a line
+actual=$( { printf a; head -c 200000 /dev/zero | tr '\0' x; printf '\nxz\n'; } | "$FORMATTER" -s --grep='^x' 2>&1)
+check_result "grep: rest of a dropped long line is dropped" "$actual" "xz"
+
+run_test "grep: invalid pattern fails" \
+    "test" \
+    "Invalid grep pattern: (x: missing ) at offset 2" \
+    --grep='(x'
+
+# =============================================================================
+echo
+echo "--- Width Tests (--width) ---"
+# =============================================================================
+
+run_test "width: tags take no space" \
+    $'{*r--ab--}c\n\nxyz' \
+    $'3\n0\n3' \
+    --width
+
+run_test "width: wide and combining characters" \
+    $'日本{g--語--}\ne\xcc\x81' \
+    $'6\n1' \
+    --width
+
+run_test "width: escape sequences take no space" \
+    $'\e[1;31mred\e[0m' \
+    "3" \
+    --width
+
+actual=$("$FORMATTER" --width "{r--ab--}" "" "x y")
+check_result "width: one line per argument" "$actual" $'2\n0\n3'
+
+# =============================================================================
+echo
+echo "--- Cut Tests (--cut) ---"
+# =============================================================================
+
+run_test "cut: truncates each line" \
+    $'abcdefgh\nab\n' \
+    $'abcd\nab' \
+    -s --cut=4
+
+run_ansi_test "cut: tags after the cut still apply" \
+    "{r--abc{g--def--}gh--}ij" \
+    "^[[0;39;49m^[[0;31;49mab^[[0;32;49m^[[0;31;49m^[[0;39;49m^[[0;39;49m" \
+    --cut=2
+
+run_test "cut: ellipsis replaces the tail" \
+    $'abcdefgh\nabcd\n' \
+    $'ab..\nabcd' \
+    -s --cut=4 --ellipsis=..
+
+run_test "cut: wide characters are not split" \
+    "日本語" \
+    "日本" \
+    -s --cut=5
+
+run_test "cut: invalid column count fails" \
+    "test" \
+    "Invalid column count: 0 (expected a positive number)" \
+    --cut=0
+
+# =============================================================================
+echo
+echo "--- Table Tests (--table) ---"
+# =============================================================================
+
+run_test "table: aligns columns" \
+    $'a|bb|c\nccc|d|e\n' \
+    $'a    bb  c\nccc  d   e' \
+    -s --table='|'
+
+run_ansi_test "table: tags take no width" \
+    $'{r--a--};b\nccc;d\n' \
+    $'^[[0;39;49m^[[0;31;49ma^[[0;39;49m    b\nccc  d\n^[[0;39;49m' \
+    --table=';'
+
+run_test "table: last cell does not widen its column" \
+    $'a long title\nx|y\n' \
+    $'a long title\nx  y' \
+    -s --table='|'
+
+run_test "table: wide characters count twice" \
+    $'日本|x\nabcde|y\n' \
+    $'日本   x\nabcde  y' \
+    -s --table='|'
+
+# =============================================================================
+echo
+echo "--- ANSI Optimizer Tests (--optimize-ansi) ---"
+# =============================================================================
+
+run_ansi_test "optimize: merges adjacent tags" \
+    "{r--a--}{r--b--} c" \
+    "^[[0;31mab^[[0m c" \
+    --optimize-ansi
+
+run_ansi_test "optimize: relative changes when shorter" \
+    "{*--a{g--b--}--}" \
+    "^[[0;1ma^[[32mb^[[0m" \
+    --optimize-ansi
+
+run_ansi_test "optimize: input escapes are tracked" \
+    $'\e[0m\e[31mred\e[0m\e[0m \e[31m\e[1mbold\e[0m' \
+    "^[[0;31mred^[[0m ^[[1;31mbold^[[0m" \
+    -S --optimize-ansi
+
+run_ansi_test "optimize: extended colors and other escapes pass" \
+    $'\e[38;5;200mx\e[1my\e[0m\e[K' \
+    "^[[0;38;5;200mx^[[1my^[[0m^[[K" \
+    -S --optimize-ansi
+
+run_ansi_test "optimize: repeated unknown attributes are kept once" \
+    $'a\e[51mb\e[51mc\e[51md\e[1me\e[52mf' \
+    "^[[0ma^[[51mbcd^[[1me^[[52mf" \
+    -S --optimize-ansi
+
+# =============================================================================
+echo
+echo "--- Stats Tests (--stats) ---"
+# =============================================================================
+
+stats_err=$(printf '{r--ab--}\n' | "$FORMATTER" -s --stats 2>&1 >/dev/null)
+check_result "stats: sizes on stderr" \
+    "$(echo "$stats_err" | grep -E '^stats: (input|output) ' | tr -s ' ')" \
+    $'stats: input 10 bytes\nstats: output 3 bytes'
+
+check_result "stats: output unchanged" \
+    "$(printf '{r--ab--}\n' | "$FORMATTER" -s --stats 2>/dev/null)" \
+    "ab"
+
+check_result "stats: counters reported or explained" \
+    "$(echo "$stats_err" | grep -cE '^stats: (cycles|counters unavailable)')" \
+    "1"
+
+progress_err=$(printf '{r--ab--}{g--c--}\n' > "$PROGRESS_INPUT"
+               "$FORMATTER" --progress < "$PROGRESS_INPUT" 2>&1 >/dev/null)
+check_result "progress: final report with percentage for files" \
+    "$(echo "$progress_err" | tail -1 | grep -cE '^progress: +0\.0 MB .* tags/s .* waiting for input +100\.0%$')" \
+    "1"
+
+check_result "progress: no percentage for pipes" \
+    "$(printf 'abc\n' | "$FORMATTER" --progress 2>&1 >/dev/null | grep -c '%$')" \
+    "0"
+
+# =============================================================================
+echo
+echo "--- Flood Tests (--max-rate, --dedupe) ---"
+# =============================================================================
+
+check_result "dedupe: runs of identical lines folded" \
+    "$(printf 'a\na\na\n{r--b--}\nb\nb\nc' | "$FORMATTER" -s --dedupe)" \
+    "a
+last line repeated 2 times
+b
+b
+last line repeated 1 time
+c"
+
+check_result "max-rate: lines over the rate suppressed unrendered" \
+    "$(printf 'one\n{r--two\nthree\n' | "$FORMATTER" --max-rate=1/s | cat -v)" \
+    "^[[0;39;49mone
+2 lines suppressed
+^[[0;39;49m"
+
+run_test "max-rate: invalid rate fails" \
+    "" \
+    "Invalid rate: 0 (expected a positive number of lines per second)" \
+    --max-rate=0
+
+# =============================================================================
+echo
+echo "--- Profile Tests (--profile-input, --generate-input) ---"
+# =============================================================================
+
+printf 'a {r--x {*--y--}--}\\t\n\nzz' > "$PROFILE_INPUT"
+check_result "profile: statistics of the input, no content" \
+    "$("$FORMATTER" -e --profile-input < "$PROFILE_INPUT" | grep -v '^#')" \
+    "bytes 25
+lines 3
+tags 2
+escapes 1
+line-length 1 0
+line-length 1 2
+line-length 1 16
+depth 1 1
+depth 1 2
+specifier 1 *
+specifier 1 r
+escape 1 t"
+
+"$FORMATTER" --profile-input < "$PROFILE_INPUT" > "$PROFILE"
+"$FORMATTER" --generate-input="$PROFILE" > "$PROFILE_INPUT"
+check_result "profile: generated input as large as the profiled one, with tags" \
+    "$("$FORMATTER" --profile-input < "$PROFILE_INPUT" | grep -cE '^(bytes (2[4-9]|[3-9][0-9])|tags [1-9])')" \
+    "2"
+
+for i in $(seq 300); do echo "some log text {r--here--} and more x"; done > "$PROFILE_INPUT"
+"$FORMATTER" --profile-input < "$PROFILE_INPUT" > "$PROFILE"
+check_result "profile: generated lines keep the profiled lengths, markup included" \
+    "$("$FORMATTER" --generate-input="$PROFILE" | "$FORMATTER" --profile-input | awk '/^line-length/ { print $3 }')" \
+    "$(awk '/^line-length/ { print $3 }' "$PROFILE")"
+
+"$FORMATTER" --generate-input="$PROFILE" -x xml > "$PROFILE_INPUT"
+check_result "profile: generated input uses the given syntax" \
+    "$(grep -c '<r>' "$PROFILE_INPUT" >/dev/null && echo xml) $(grep -c '{r--' "$PROFILE_INPUT" || true)" \
+    "xml 0"
+
+
+# =============================================================================
+echo
+echo "--- Catalog Tests (--emit-header) ---"
+# =============================================================================
+
+printf '# messages\nHELLO = {r--Hi--} "you"\nWIDE=日本\\n{*--x--}\n' > "$CATALOG"
+GUARD=$(basename "$CATALOG" | tr 'a-z.' 'A-Z_')_H
+
+run_test "catalog: header with rendered, plain and width" \
+    "" \
+    "/* Generated by formatter --emit-header; do not edit. */
+#ifndef $GUARD
+#define $GUARD
+
+#define HELLO_ANSI  \"\\033[0;39;49m\\033[0;31;49mHi\\033[0;39;49m \\\"you\\\"\\033[0;39;49m\"
+#define HELLO_PLAIN \"Hi \\\"you\\\"\"
+#define HELLO_WIDTH 8
+
+#define WIDE_ANSI  \"\\033[0;39;49m\\346\\227\\245\\346\\234\\254\\012\\033[0;1;39;49mx\\033[0;39;49m\\033[0;39;49m\"
+#define WIDE_PLAIN \"\\346\\227\\245\\346\\234\\254\\012x\"
+#define WIDE_WIDTH 4
+
+#endif /* $GUARD */" \
+    -e --emit-header "$CATALOG"
+
+printf 'OK = fine\nOK = again\n' > "$BAD_CATALOG"
+run_test "catalog: duplicate ID fails" \
+    "" \
+    "Invalid catalog file: $BAD_CATALOG: line 2: duplicate ID 'OK'" \
+    --emit-header "$BAD_CATALOG"
+
+printf '2ND = text\n' > "$BAD_CATALOG"
+run_test "catalog: ID must be a C identifier" \
+    "" \
+    "Invalid catalog file: $BAD_CATALOG: line 1: '2ND' is not a C identifier" \
+    --emit-header "$BAD_CATALOG"
+
+# =============================================================================
+echo
+echo "--- Palette Tests (--palette) ---"
+# =============================================================================
+
+printf '# theme\nr #ff5f00\nfg:d 250\nbg:d k\nG   B\n' > "$PALETTE"
+
+run_ansi_test "palette: true color, 256-color and named remaps" \
+    "{*r--a--}{G--b--}" \
+    "^[[0;38;5;250;40m^[[0;1;38;2;255;95;0;40ma^[[0;38;5;250;40m^[[0;94;40mb^[[0;38;5;250;40m^[[0;39;49m" \
+    --palette "$PALETTE"
+
+printf 'bg:d 236\n' > "$PALETTE"
+run_ansi_test "palette: output ends with the terminal's defaults" \
+    "{r--a--}b" \
+    "^[[0;39;48;5;236m^[[0;31;48;5;236ma^[[0;39;48;5;236mb^[[0;39;49m" \
+    --palette "$PALETTE"
+
+printf 'r #ff5f0\n' > "$BAD_PALETTE"
+run_test "palette: invalid value fails" \
+    "" \
+    "Invalid palette file: $BAD_PALETTE: line 1: invalid color value '#ff5f0'" \
+    --palette "$BAD_PALETTE"
+
+# =============================================================================
+echo
+echo "--- Alphabet Tests (--alphabet) ---"
+# =============================================================================
+
+printf '# payloads use * and _\nbold +\nunderline |\nbright-red *\n' > "$ALPHABET"
+
+run_ansi_test "alphabet: remapped styles and colors" \
+    "{+*--a_b--}{|--c--}" \
+    "^[[0;39;49m^[[0;1;91;49ma_b^[[0;39;49m^[[0;4;39;49mc^[[0;39;49m^[[0;39;49m" \
+    --alphabet "$ALPHABET"
+
+run_ansi_test "alphabet: freed characters are no longer specifiers" \
+    "{_--x--}" \
+    "^[[0;39;49m{_--x--}^[[0;39;49m" \
+    --alphabet "$ALPHABET"
+
+printf 'err +\n' > "$ALPHABET_RULES"
+run_ansi_test "alphabet: applies to --rules given before it" \
+    "an err" \
+    "^[[0;39;49man ^[[0;1;39;49merr^[[0;39;49m^[[0;39;49m" \
+    --rules="$ALPHABET_RULES" --alphabet "$ALPHABET"
+
+printf '* #ff0000\n' > "$ALPHABET_PALETTE"
+run_ansi_test "alphabet: names the colors of --palette" \
+    "{*--x--}" \
+    "^[[0;39;49m^[[0;38;2;255;0;0;49mx^[[0;39;49m^[[0;39;49m" \
+    --palette "$ALPHABET_PALETTE" --alphabet "$ALPHABET"
+
+printf 'bold r\n' > "$BAD_ALPHABET"
+run_test "alphabet: clashing characters fail" \
+    "" \
+    "Invalid alphabet file: $BAD_ALPHABET: 'r' used for both red and bold" \
+    --alphabet "$BAD_ALPHABET"
+
+# =============================================================================
+echo
+echo "--- Compression Tests (--compress) ---"
+# =============================================================================
+
+check_result "compress: gzip output decompresses to the rendered text" \
+    "$(printf '{r--a--}\nb\n' | "$FORMATTER" --compress=gzip | gzip -dc | cat -v)" \
+    "$(printf '{r--a--}\nb\n' | "$FORMATTER" | cat -v)"
+
+if "$FORMATTER" --compress=zstd < /dev/null > /dev/null 2>&1 && command -v zstd > /dev/null; then
+    check_result "compress: zstd output decompresses to the rendered text" \
+        "$(printf '{r--a--}\nb\n' | "$FORMATTER" --compress=zstd | zstd -dc | cat -v)" \
+        "$(printf '{r--a--}\nb\n' | "$FORMATTER" | cat -v)"
+else
+    echo -e "${YELLOW}SKIP${NC}: compress: zstd (not built in, see WITH_ZSTD in the Makefile, or no zstd command)"
+fi
+
+# Input larger than a write is staged: encoded straight from the input
+check_result "compress: large input round-trips" \
+    "$(seq 1 200000 | "$FORMATTER" -s --compress=gzip | gzip -dc | cksum)" \
+    "$(seq 1 200000 | cksum)"
+
+# SIGINT still ends the stream: everything written so far plus the trailer
+{ printf '{r--partial\n'; sleep 2; } | "$FORMATTER" --compress=gzip > "$COMPRESSED" & pid=$!
+sleep 0.5; kill -INT $pid; wait $pid || true
+check_result "compress: SIGINT writes a complete stream" \
+    "$(gzip -dc < "$COMPRESSED" 2>&1 | cat -v)" \
+    "$(printf '^[[0;39;49m^[[0;31;49mpartial\n^[[0;39;49m')"
+
+run_test "compress: unknown format fails" \
+    "test" \
+    "Unknown compression: lz4
+Available: gzip, zstd" \
+    --compress=lz4
+
+# =============================================================================
+echo
+echo "--- Signal Tests ---"
+# =============================================================================
+
+# SIGTERM mid-stream: buffered output is flushed and followed by a reset
+actual=$( { printf '{r--partial'; sleep 2; } | "$FORMATTER" --flush=full & pid=$!
+          sleep 0.5; kill -TERM $pid; wait $pid; echo " status=$?" )
+check_result "signal: SIGTERM flushes and resets" \
+    "$(echo -n "$actual" | cat -v)" \
+    "^[[0;39;49m^[[0;31;49mpartial^[[0;39;49m status=143"
+
+actual=$( { printf '{r--partial'; sleep 2; } | "$FORMATTER" -s --flush=full & pid=$!
+          sleep 0.5; kill -INT $pid; wait $pid; echo " status=$?" )
+check_result "signal: SIGINT in strip mode emits no reset" \
+    "$actual" \
+    "partial status=130"
+
+# Input held back inside a possible tag is finished like at the end of input
+actual=$( { printf 'ab{r-'; sleep 2; } | "$FORMATTER" -s & pid=$!
+          sleep 0.5; kill -INT $pid; wait $pid; echo " status=$?" )
+check_result "signal: SIGINT finishes a pending tag as text" \
+    "$actual" \
+    "ab{r- status=130"
+
+# Reader going away is a clean exit, not an error
+actual=$( yes '{r--x--}' | "$FORMATTER" | head -c 1 > /dev/null; echo "${PIPESTATUS[1]}" )
+check_result "signal: SIGPIPE exits cleanly" "$actual" "0"
+
 # =============================================================================
 echo
 echo "========================================"